@@ -0,0 +1,97 @@
+#include "bitboard.h"
+
+#include <mutex>
+
+namespace Bitboards {
+	Magic rookMagics[64];
+	Magic bishopMagics[64];
+
+	static Bitboard rookTable[0x19000];
+	static Bitboard bishopTable[0x1480];
+
+	static const int rookDirections[4][2] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+	static const int bishopDirections[4][2] = {{1, 1}, {1, -1}, {-1, 1}, {-1, -1}};
+
+	// Walks the rays one square at a time, only used to build the tables.
+	static Bitboard slidingAttacks(int square, Bitboard occupied, const int directions[4][2]) {
+		Bitboard attacks = 0;
+		for (int i = 0; i < 4; i++) {
+			int file = square % 8 + directions[i][0];
+			int rank = square / 8 + directions[i][1];
+			while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+				attacks |= squareBB(rank * 8 + file);
+				if (occupied & squareBB(rank * 8 + file)) break;
+				file += directions[i][0];
+				rank += directions[i][1];
+			}
+		}
+		return attacks;
+	}
+
+	// xorshift64*, the seed is fixed so the magics (and startup time) are the same on every run
+	static uint64_t nextRandom(uint64_t &state) {
+		state ^= state >> 12;
+		state ^= state << 25;
+		state ^= state >> 27;
+		return state * 2685821657736338717ULL;
+	}
+
+	static void initMagics(Magic magics[64], Bitboard *table, const int directions[4][2]) {
+		Bitboard occupancy[4096], reference[4096];
+		int epoch[4096] = {0};
+		int currentEpoch = 0;
+		uint64_t seed = 728;
+		Bitboard *attacks = table;
+
+		for (int square = 0; square < 64; square++) {
+			Magic &m = magics[square];
+			// the last square of a ray is attacked whether it is occupied or not
+			Bitboard edges = ((RANK_1 | RANK_8) & ~(RANK_1 << (square / 8 * 8))) | ((FILE_A | FILE_H) & ~(FILE_A << (square % 8)));
+			m.mask = slidingAttacks(square, 0, directions) & ~edges;
+			m.shift = 64 - popCount(m.mask);
+			m.attacks = attacks;
+
+			int size = 0;
+			Bitboard subset = 0;
+			do {
+				occupancy[size] = subset;
+				reference[size] = slidingAttacks(square, subset, directions);
+				size++;
+				subset = (subset - m.mask) & m.mask;
+			} while (subset);
+			attacks += size;
+
+#ifdef __BMI2__
+			for (int i = 0; i < size; i++) {
+				m.attacks[m.index(occupancy[i])] = reference[i];
+			}
+#else
+			for (int i = 0; i < size;) {
+				do {
+					m.magic = nextRandom(seed) & nextRandom(seed) & nextRandom(seed);
+				} while (popCount((m.mask * m.magic) >> 56) < 6);
+				currentEpoch++;
+				for (i = 0; i < size; i++) {
+					unsigned index = m.index(occupancy[i]);
+					if (epoch[index] < currentEpoch) {
+						epoch[index] = currentEpoch;
+						m.attacks[index] = reference[i];
+					} else if (m.attacks[index] != reference[i]) {
+						break;
+					}
+				}
+			}
+#endif
+		}
+	}
+
+	static void initTables() {
+		initMagics(rookMagics, rookTable, rookDirections);
+		initMagics(bishopMagics, bishopTable, bishopDirections);
+	}
+
+	void init() {
+		static std::once_flag once;
+		std::call_once(once, initTables);
+	}
+} // namespace Bitboards
@@ -0,0 +1,141 @@
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <array>
+#include <cstdint>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+// Squares are numbered rank * 8 + file, so a1 = 0, h1 = 7, a8 = 56 and h8 = 63.
+typedef uint64_t Bitboard;
+
+namespace Bitboards {
+	constexpr Bitboard FILE_A = 0x0101010101010101ULL;
+	constexpr Bitboard FILE_H = FILE_A << 7;
+	constexpr Bitboard RANK_1 = 0xFFULL;
+	constexpr Bitboard RANK_2 = RANK_1 << 8;
+	constexpr Bitboard RANK_3 = RANK_1 << 16;
+	constexpr Bitboard RANK_4 = RANK_1 << 24;
+	constexpr Bitboard RANK_5 = RANK_1 << 32;
+	constexpr Bitboard RANK_6 = RANK_1 << 40;
+	constexpr Bitboard RANK_7 = RANK_1 << 48;
+	constexpr Bitboard RANK_8 = RANK_1 << 56;
+
+	struct Magic {
+		Bitboard mask;
+		Bitboard magic;
+		Bitboard *attacks;
+		unsigned shift;
+
+		unsigned index(Bitboard occupied) const {
+#ifdef __BMI2__
+			return (unsigned)_pext_u64(occupied, this->mask);
+#else
+			return (unsigned)(((occupied & this->mask) * this->magic) >> this->shift);
+#endif
+		}
+	}; // struct Magic
+
+	extern Magic rookMagics[64];
+	extern Magic bishopMagics[64];
+
+	// Fills the slider tables, the magics are searched for at runtime. Safe to call
+	// more than once, only the first call does any work.
+	void init();
+
+	constexpr Bitboard squareBB(int square) {
+		return 1ULL << square;
+	}
+
+	// The fixed tables below are worked out by the compiler.
+	constexpr int KNIGHTOFFSETS[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+	constexpr int KINGOFFSETS[8][2] = {{0, 1}, {1, 1}, {1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}};
+	constexpr int WHITEPAWNOFFSETS[2][2] = {{-1, 1}, {1, 1}};
+	constexpr int BLACKPAWNOFFSETS[2][2] = {{-1, -1}, {1, -1}};
+
+	constexpr std::array<Bitboard, 64> leaperTable(const int offsets[][2], int count) {
+		std::array<Bitboard, 64> table = {};
+		for (int square = 0; square < 64; square++) {
+			for (int i = 0; i < count; i++) {
+				int file = square % 8 + offsets[i][0];
+				int rank = square / 8 + offsets[i][1];
+				if (file >= 0 && file < 8 && rank >= 0 && rank < 8) table[square] |= squareBB(rank * 8 + file);
+			}
+		}
+		return table;
+	}
+
+	// Squares strictly between two aligned squares, or the whole line through them
+	// edge to edge. Both are 0 when the squares share no rank, file or diagonal.
+	constexpr std::array<std::array<Bitboard, 64>, 64> rayTable(bool wholeLine) {
+		std::array<std::array<Bitboard, 64>, 64> table = {};
+		for (int a = 0; a < 64; a++) {
+			for (int b = 0; b < 64; b++) {
+				int fileDelta = b % 8 - a % 8, rankDelta = b / 8 - a / 8;
+				if (a == b || (fileDelta != 0 && rankDelta != 0 && fileDelta != rankDelta && fileDelta != -rankDelta)) continue;
+				int fileStep = (fileDelta > 0) - (fileDelta < 0), rankStep = (rankDelta > 0) - (rankDelta < 0);
+				if (!wholeLine) {
+					for (int square = a + rankStep * 8 + fileStep; square != b; square += rankStep * 8 + fileStep) {
+						table[a][b] |= squareBB(square);
+					}
+					continue;
+				}
+				table[a][b] = squareBB(a);
+				for (int direction = -1; direction <= 1; direction += 2) {
+					int file = a % 8 + direction * fileStep, rank = a / 8 + direction * rankStep;
+					while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+						table[a][b] |= squareBB(rank * 8 + file);
+						file += direction * fileStep;
+						rank += direction * rankStep;
+					}
+				}
+			}
+		}
+		return table;
+	}
+
+	inline constexpr std::array<Bitboard, 64> knightAttacks = leaperTable(KNIGHTOFFSETS, 8);
+	inline constexpr std::array<Bitboard, 64> kingAttacks = leaperTable(KINGOFFSETS, 8);
+	// the squares a pawn of each side takes on
+	inline constexpr std::array<std::array<Bitboard, 64>, 2> pawnAttacks = {leaperTable(WHITEPAWNOFFSETS, 2), leaperTable(BLACKPAWNOFFSETS, 2)};
+	inline constexpr std::array<std::array<Bitboard, 64>, 64> betweenBB = rayTable(false);
+	inline constexpr std::array<std::array<Bitboard, 64>, 64> lineBB = rayTable(true);
+
+	// a whole board moved by delta squares, up the board when positive
+	template <int delta>
+	constexpr Bitboard shift(Bitboard b) {
+		if constexpr (delta > 0) return b << delta;
+		else return b >> -delta;
+	}
+
+	inline int popCount(Bitboard b) {
+		return __builtin_popcountll(b);
+	}
+
+	inline int lsb(Bitboard b) {
+		return __builtin_ctzll(b);
+	}
+
+	inline int popLsb(Bitboard &b) {
+		int square = __builtin_ctzll(b);
+		b &= b - 1;
+		return square;
+	}
+
+	inline Bitboard rookAttacks(int square, Bitboard occupied) {
+		const Magic &m = rookMagics[square];
+		return m.attacks[m.index(occupied)];
+	}
+
+	inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+		const Magic &m = bishopMagics[square];
+		return m.attacks[m.index(occupied)];
+	}
+
+	inline Bitboard queenAttacks(int square, Bitboard occupied) {
+		return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+	}
+} // namespace Bitboards
+
+#endif
@@ -0,0 +1,1009 @@
+#include "board.h"
+
+#include <array>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+#include "profile.h"
+#include "zobrist.h"
+
+using namespace Bitboards;
+
+Board::Board() {
+	Bitboards::init();
+	this->enPassantFlag = -1;
+	this->castlingRights = 15;
+	this->moveCount = 0;
+	this->pliesForDraw = 0;
+	this->toPlay = WHITE;
+	this->undoStack.reserve(1024);
+	this->clearPosition();
+}
+
+void Board::setStartingPosition() {
+	this->clearPosition();
+	static const uint8_t backRank[8] = {WROOK, WKNIGHT, WBISHOP, WQUEEN, WKING, WBISHOP, WKNIGHT, WROOK};
+	for (int i = 0; i < 8; i++) {
+		this->putPiece(i, backRank[i]);
+		this->putPiece(8 + i, WPAWN);
+		this->putPiece(48 + i, BPAWN);
+		this->putPiece(56 + i, backRank[i] + WKING);
+	}
+	this->enPassantFlag = -1;
+	this->setCastlingRights(15);
+	this->moveCount = 0;
+	this->pliesForDraw = 0;
+	this->toPlay = WHITE;
+	this->key = this->computeKey();
+	this->undoStack.clear();
+}
+
+void Board::copyPosition(const Board &other) {
+	static_cast<Position &>(*this) = other;
+	this->undoStack = other.undoStack;
+}
+
+void Board::setPosition(const Position &position) {
+	static_cast<Position &>(*this) = position;
+	this->undoStack.clear();
+}
+
+void Board::rewind(const Position &position, size_t plies) {
+	static_cast<Position &>(*this) = position;
+	this->undoStack.resize(plies);
+}
+
+void Board::putPiece(uint8_t square, uint8_t piece) {
+	Bitboard bb = squareBB(square);
+	this->mailbox[square / 2] |= piece << (square % 2 * 4);
+	this->key ^= Zobrist::keys.pieces[piece][square];
+	this->byType[ALLPIECES] |= bb;
+	this->byType[pieceType(piece)] |= bb;
+	this->byColor[piece > WKING] |= bb;
+	this->mgScore += Eval::tables.mg[piece][square];
+	this->egScore += Eval::tables.eg[piece][square];
+	this->phase += Eval::tables.phase[piece];
+}
+
+void Board::removePiece(uint8_t square) {
+	Bitboard bb = squareBB(square);
+	uint8_t piece = this->pieceOn(square);
+	this->mailbox[square / 2] ^= piece << (square % 2 * 4);
+	this->key ^= Zobrist::keys.pieces[piece][square];
+	this->byType[ALLPIECES] ^= bb;
+	this->byType[pieceType(piece)] ^= bb;
+	this->byColor[piece > WKING] ^= bb;
+	this->mgScore -= Eval::tables.mg[piece][square];
+	this->egScore -= Eval::tables.eg[piece][square];
+	this->phase -= Eval::tables.phase[piece];
+}
+
+Bitboard Board::getAttacks(Coordinates piece) {
+	PROFILE_SCOPE(GETATTACKS);
+	uint8_t square = piece.toSquare();
+	switch (this->pieceOn(square)) {
+		case WPAWN:
+			return pawnAttacks[WHITE][square];
+		case BPAWN:
+			return pawnAttacks[BLACK][square];
+		case WKNIGHT:
+		case BKNIGHT:
+			return knightAttacks[square];
+		case WBISHOP:
+		case BBISHOP:
+			return bishopAttacks(square, this->byType[ALLPIECES]);
+		case WROOK:
+		case BROOK:
+			return rookAttacks(square, this->byType[ALLPIECES]);
+		case WQUEEN:
+		case BQUEEN:
+			return queenAttacks(square, this->byType[ALLPIECES]);
+		case WKING:
+		case BKING:
+			return kingAttacks[square];
+	}
+	return 0;
+}
+
+bool Board::attacks(Coordinates piece, Coordinates target) {
+	PROFILE_SCOPE(ATTACKS);
+	return this->getAttacks(piece) & squareBB(target.toSquare());
+}
+
+Bitboard Board::attackersTo(uint8_t square, Bitboard occupied) const {
+	PROFILE_SCOPE(ATTACKERSTO);
+	return (pawnAttacks[BLACK][square] & this->getPieces(WHITE, PAWN))
+		| (pawnAttacks[WHITE][square] & this->getPieces(BLACK, PAWN))
+		| (knightAttacks[square] & this->byType[KNIGHT])
+		| (kingAttacks[square] & this->byType[KING])
+		| (bishopAttacks(square, occupied) & (this->byType[BISHOP] | this->byType[QUEEN]))
+		| (rookAttacks(square, occupied) & (this->byType[ROOK] | this->byType[QUEEN]));
+}
+
+bool Board::isInCheck(bool side) {
+	PROFILE_SCOPE(ISINCHECK);
+	return this->attackersTo(this->kingSquare(side), this->byType[ALLPIECES]) & this->byColor[!side];
+}
+
+// The swap algorithm: gains[depth] is what the side taking at that depth is up if
+// the other side stops there. They're worked out going forward, then each side's
+// choice to stop or take back is settled going backward.
+int Board::see(Move move) const {
+	PROFILE_SCOPE(SEE);
+	uint8_t from = move.from();
+	uint8_t to = move.to();
+	if (move.type() == Move::CASTLING) return 0;
+	Bitboard occupied = this->byType[ALLPIECES] ^ squareBB(from);
+	uint8_t attacker = pieceType(this->pieceOn(from));
+	int gains[32];
+	gains[0] = PIECEVALUES[pieceType(this->pieceOn(to))];
+	if (move.type() == Move::ENPASSANT) {
+		// the pawn taken stands beside the one taking
+		occupied ^= squareBB((from & 56) | (to & 7));
+		gains[0] = PIECEVALUES[PAWN];
+	} else if (move.type() == Move::PROMOTION) {
+		gains[0] += PIECEVALUES[move.promotion()] - PIECEVALUES[PAWN];
+		attacker = move.promotion();
+	}
+	Bitboard diagonal = this->byType[BISHOP] | this->byType[QUEEN];
+	Bitboard straight = this->byType[ROOK] | this->byType[QUEEN];
+	Bitboard attackers = this->attackersTo(to, occupied) & occupied;
+	bool side = this->pieceOn(from) > WKING;
+	int depth = 0;
+	while (depth < 31) {
+		side = !side;
+		Bitboard own = attackers & this->byColor[side];
+		if (!own) break;
+		uint8_t type = PAWN;
+		while (!(own & this->byType[type])) {
+			type++;
+		}
+		// the king may only take last
+		if (type == KING && (attackers & this->byColor[!side])) break;
+		depth++;
+		gains[depth] = PIECEVALUES[attacker] - gains[depth - 1];
+		occupied ^= squareBB(lsb(own & this->byType[type]));
+		if (type == PAWN || type == BISHOP || type == QUEEN) attackers |= bishopAttacks(to, occupied) & diagonal;
+		if (type == ROOK || type == QUEEN) attackers |= rookAttacks(to, occupied) & straight;
+		attackers &= occupied;
+		attacker = type;
+	}
+	for (; depth > 0; depth--) {
+		gains[depth - 1] = -std::max(-gains[depth - 1], gains[depth]);
+	}
+	return gains[0];
+}
+
+void Board::addPawnMoves(MoveList &moves, uint8_t from, Bitboard targets) {
+	while (targets) {
+		uint8_t to = popLsb(targets);
+		if (to < 8 || to >= 56) {
+			for (uint8_t promotion = KNIGHT; promotion <= QUEEN; promotion++) {
+				moves.add(Move(from, to, Move::PROMOTION, promotion));
+			}
+		} else {
+			moves.add(Move(from, to));
+		}
+	}
+}
+
+// Everything about a side the move generation needs, known at compile time.
+template <bool side>
+struct SideInfo {
+	static constexpr bool THEM = !side;
+	// one step forward for a pawn
+	static constexpr int UP = side == Board::WHITE ? 8 : -8;
+	static constexpr Bitboard PAWNSTART = side == Board::WHITE ? RANK_2 : RANK_7;
+	// pawns that got here with one step may take another
+	static constexpr Bitboard SINGLEPUSHED = side == Board::WHITE ? RANK_3 : RANK_6;
+	// the en passant target is this plus the file
+	static constexpr uint8_t ENPASSANTRANK = side == Board::WHITE ? 40 : 16;
+	static constexpr uint8_t PAWN = Board::makePiece(side, Board::PAWN);
+	static constexpr uint8_t ROOK = Board::makePiece(side, Board::ROOK);
+	// the side's two castling bits, king side first
+	static constexpr int CASTLINGSHIFT = side == Board::WHITE ? 0 : 2;
+}; // struct SideInfo
+
+// Own pieces that are the only thing between their king and an enemy slider.
+template <bool side>
+Bitboard Board::pinnedPieces(uint8_t king) const {
+	Bitboard pinned = 0;
+	Bitboard occupied = this->byType[ALLPIECES];
+	Bitboard snipers = ((rookAttacks(king, 0) & (this->byType[ROOK] | this->byType[QUEEN]))
+		| (bishopAttacks(king, 0) & (this->byType[BISHOP] | this->byType[QUEEN]))) & this->byColor[SideInfo<side>::THEM];
+	while (snipers) {
+		Bitboard blockers = betweenBB[king][popLsb(snipers)] & occupied;
+		if (Bitboards::popCount(blockers) == 1) pinned |= blockers & this->byColor[side];
+	}
+	return pinned;
+}
+
+// Where a piece other than the king may go, en passant left out, limited to the allowed squares.
+template <bool side>
+Bitboard Board::pieceTargets(uint8_t from, Bitboard allowed) const {
+	typedef SideInfo<side> Us;
+	Bitboard occupied = this->byType[ALLPIECES];
+	switch (pieceType(this->pieceOn(from))) {
+		case PAWN: {
+			Bitboard targets = pawnAttacks[side][from] & this->byColor[Us::THEM];
+			if (this->pieceOn(from + Us::UP) == EMPTY) {
+				targets |= squareBB(from + Us::UP);
+				if ((squareBB(from) & Us::PAWNSTART) && this->pieceOn(from + 2 * Us::UP) == EMPTY) {
+					targets |= squareBB(from + 2 * Us::UP);
+				}
+			}
+			return targets & allowed;
+		}
+		case KNIGHT:
+			return knightAttacks[from] & ~this->byColor[side] & allowed;
+		case BISHOP:
+			return bishopAttacks(from, occupied) & ~this->byColor[side] & allowed;
+		case ROOK:
+			return rookAttacks(from, occupied) & ~this->byColor[side] & allowed;
+		case QUEEN:
+			return queenAttacks(from, occupied) & ~this->byColor[side] & allowed;
+	}
+	return 0;
+}
+
+// Whether taking en passant with the pawn on from leaves the king safe. The captured pawn
+// and the capturing one both leave the king's lines, so everything is checked again.
+template <bool side>
+bool Board::enPassantIsLegal(uint8_t from) {
+	typedef SideInfo<side> Us;
+	uint8_t king = this->kingSquare(side);
+	uint8_t target = this->enPassantFlag + Us::ENPASSANTRANK;
+	uint8_t captured = target - Us::UP;
+	Bitboard after = (this->byType[ALLPIECES] ^ squareBB(from) ^ squareBB(captured)) | squareBB(target);
+	return !(this->attackersTo(king, after) & this->byColor[Us::THEM] & ~squareBB(captured));
+}
+
+template <bool side>
+bool Board::castlingIsLegal(bool kingSide) {
+	typedef SideInfo<side> Us;
+	uint8_t king = this->kingSquare(side);
+	if (!(this->castlingRights & ((kingSide ? 1 : 2) << Us::CASTLINGSHIFT))) return false;
+	uint8_t rook = kingSide ? king + 3 : king - 4;
+	int step = kingSide ? 1 : -1;
+	Bitboard occupied = this->byType[ALLPIECES];
+	Bitboard enemies = this->byColor[Us::THEM];
+	return this->pieceOn(rook) == Us::ROOK && !(occupied & betweenBB[king][rook])
+		&& !(this->attackersTo(king + step, occupied) & enemies)
+		&& !(this->attackersTo(king + 2 * step, occupied) & enemies);
+}
+
+// Checkers and pinned pieces are worked out once, then every piece only gets
+// targets that resolve the check and stay on its pin line, so nothing is tried out on the board.
+template <bool side>
+void Board::generateLegalMoves(Bitboard fromMask, uint8_t kinds, MoveList &moves) {
+	PROFILE_SCOPE(GENERATELEGALMOVES);
+	typedef SideInfo<side> Us;
+	Bitboard own = this->byColor[side];
+	Bitboard enemies = this->byColor[Us::THEM];
+	Bitboard occupied = this->byType[ALLPIECES];
+	uint8_t king = this->kingSquare(side);
+	Bitboard checkers = this->attackersTo(king, occupied) & enemies;
+	// where the kinds asked for may go, for pawns a promotion is noisy even without a capture
+	Bitboard kindMask = ((kinds & NOISY) ? enemies : 0) | ((kinds & QUIET) ? ~occupied : 0);
+	Bitboard pawnMask = ((kinds & NOISY) ? enemies | RANK_1 | RANK_8 : 0) | ((kinds & QUIET) ? ~occupied & ~(RANK_1 | RANK_8) : 0);
+
+	if (fromMask & squareBB(king)) {
+		Bitboard targets = kingAttacks[king] & ~own & kindMask;
+		while (targets) {
+			uint8_t to = popLsb(targets);
+			if (!(this->attackersTo(to, occupied ^ squareBB(king)) & enemies)) moves.add(Move(king, to));
+		}
+		if (!checkers && (kinds & QUIET)) {
+			if (this->castlingIsLegal<side>(true)) moves.add(Move(king, king + 2, Move::CASTLING));
+			if (this->castlingIsLegal<side>(false)) moves.add(Move(king, king - 2, Move::CASTLING));
+		}
+	}
+	// in double check only the king can move
+	if (Bitboards::popCount(checkers) > 1) return;
+
+	Bitboard checkMask = ~0ULL;
+	if (checkers) checkMask = betweenBB[king][lsb(checkers)] | checkers;
+	Bitboard pinned = this->pinnedPieces<side>(king);
+
+	Bitboard pieces = own & ~this->byType[KING] & fromMask;
+	while (pieces) {
+		uint8_t from = popLsb(pieces);
+		bool pawn = this->byType[PAWN] & squareBB(from);
+		Bitboard pinMask = (pinned & squareBB(from)) ? lineBB[king][from] : ~0ULL;
+		Bitboard targets = this->pieceTargets<side>(from, checkMask & pinMask & (pawn ? pawnMask : kindMask));
+		if (pawn) {
+			this->addPawnMoves(moves, from, targets);
+			if (this->enPassantFlag != -1 && (kinds & NOISY)) {
+				uint8_t target = this->enPassantFlag + Us::ENPASSANTRANK;
+				if ((pawnAttacks[side][from] & squareBB(target)) && this->enPassantIsLegal<side>(from)) {
+					moves.add(Move(from, target, Move::ENPASSANT));
+				}
+			}
+		} else {
+			while (targets) {
+				moves.add(Move(from, popLsb(targets)));
+			}
+		}
+	}
+}
+
+Move Board::randomLegalMove(Rng &rng) {
+	return this->toPlay == WHITE ? this->pickRandomMove<WHITE>(rng) : this->pickRandomMove<BLACK>(rng);
+}
+
+// Picks a legal move uniformly at random without listing them. The legal targets
+// come in groups as bitboards, a piece's like in generateLegalMoves(), or the pawns
+// that step or take the same way all at once, and a random index is looked up among
+// them. King steps, castling and en passant are only checked once drawn, and a failed
+// one is dropped before drawing again, which keeps the choice uniform.
+template <bool side>
+Move Board::pickRandomMove(Rng &rng) {
+	PROFILE_SCOPE(RANDOMLEGALMOVE);
+	typedef SideInfo<side> Us;
+	Bitboard own = this->byColor[side];
+	Bitboard enemies = this->byColor[Us::THEM];
+	Bitboard occupied = this->byType[ALLPIECES];
+	uint8_t king = this->kingSquare(side);
+	Bitboard checkers = this->attackersTo(king, occupied) & enemies;
+
+	// a group's moves start on from, or for pawns back squares behind the target
+	Bitboard targets[20];
+	uint8_t from[20];
+	int8_t back[20];
+	bool pawnGroup[20];
+	int counts[20];
+	int groups = 0, total = 0;
+	auto addGroup = [&](Bitboard groupTargets, uint8_t groupFrom, int8_t groupBack, bool pawns) {
+		if (!groupTargets) return;
+		// a promotion is four moves
+		int count = Bitboards::popCount(groupTargets) + (pawns ? 3 * Bitboards::popCount(groupTargets & (RANK_1 | RANK_8)) : 0);
+		targets[groups] = groupTargets;
+		from[groups] = groupFrom;
+		back[groups] = groupBack;
+		pawnGroup[groups] = pawns;
+		counts[groups++] = count;
+		total += count;
+	};
+	Move special[4];
+	int specialCount = 0;
+	if (Bitboards::popCount(checkers) <= 1) {
+		Bitboard checkMask = checkers ? betweenBB[king][lsb(checkers)] | checkers : ~0ULL;
+		Bitboard pinned = this->pinnedPieces<side>(king);
+		Bitboard pawns = this->getPieces(side, PAWN) & ~pinned;
+		Bitboard empty = ~occupied;
+		// a capture towards the h file is a step and one square more, towards the a file one square less
+		Bitboard single = shift<Us::UP>(pawns) & empty;
+		addGroup(single & checkMask, 0, Us::UP, true);
+		addGroup(shift<Us::UP>(single & Us::SINGLEPUSHED) & empty & checkMask, 0, 2 * Us::UP, true);
+		addGroup(shift<Us::UP + 1>(pawns & ~FILE_H) & enemies & checkMask, 0, Us::UP + 1, true);
+		addGroup(shift<Us::UP - 1>(pawns & ~FILE_A) & enemies & checkMask, 0, Us::UP - 1, true);
+		Bitboard pieces = own & ~this->byType[KING] & ~pawns;
+		while (pieces) {
+			uint8_t square = popLsb(pieces);
+			Bitboard pinMask = (pinned & squareBB(square)) ? lineBB[king][square] : ~0ULL;
+			Bitboard pieceMoves = this->pieceTargets<side>(square, checkMask & pinMask);
+			// pinned pawns come one by one like the pieces
+			addGroup(pieceMoves, square, 0, this->byType[PAWN] & squareBB(square));
+		}
+		if (this->enPassantFlag != -1) {
+			uint8_t target = this->enPassantFlag + Us::ENPASSANTRANK;
+			Bitboard takers = pawnAttacks[Us::THEM][target] & this->getPieces(side, PAWN);
+			while (takers) {
+				special[specialCount++] = Move(popLsb(takers), target, Move::ENPASSANT);
+			}
+		}
+	}
+	uint8_t rights = this->castlingRights >> Us::CASTLINGSHIFT;
+	if (!checkers && (rights & 1)) special[specialCount++] = Move(king, king + 2, Move::CASTLING);
+	if (!checkers && (rights & 2)) special[specialCount++] = Move(king, king - 2, Move::CASTLING);
+	Bitboard kingTargets = kingAttacks[king] & ~own;
+
+	while (true) {
+		int kingCount = Bitboards::popCount(kingTargets);
+		int all = total + kingCount + specialCount;
+		if (all == 0) return Move::none();
+		int index = rng.below(all);
+		if (index < total) {
+			int group = 0;
+			while (index >= counts[group]) {
+				index -= counts[group++];
+			}
+			Bitboard groupTargets = targets[group];
+			while (true) {
+				uint8_t to = popLsb(groupTargets);
+				uint8_t origin = back[group] ? to - back[group] : from[group];
+				bool promotion = pawnGroup[group] && (to < 8 || to >= 56);
+				if (promotion && index < 4) return Move(origin, to, Move::PROMOTION, KNIGHT + index);
+				if (!promotion && index == 0) return Move(origin, to);
+				index -= promotion ? 4 : 1;
+			}
+		}
+		index -= total;
+		if (index < kingCount) {
+			Bitboard rest = kingTargets;
+			for (int i = 0; i < index; i++) {
+				rest &= rest - 1;
+			}
+			uint8_t to = lsb(rest);
+			if (!(this->attackersTo(to, occupied ^ squareBB(king)) & enemies)) return Move(king, to);
+			kingTargets ^= squareBB(to);
+			PROFILE_VALUE(REJECTIONS, 1);
+			continue;
+		}
+		index -= kingCount;
+		Move move = special[index];
+		bool legal = move.type() == Move::CASTLING ? this->castlingIsLegal<side>(move.to() > move.from()) : this->enPassantIsLegal<side>(move.from());
+		if (legal) return move;
+		special[index] = special[--specialCount];
+		PROFILE_VALUE(REJECTIONS, 1);
+	}
+}
+
+void Board::getLegalMoves(MoveList &moves) {
+	this->getLegalMoves(moves, ALLMOVES);
+}
+
+void Board::getLegalMoves(MoveList &moves, uint8_t kinds) {
+	PROFILE_SCOPE(GETLEGALMOVES);
+	if (this->toPlay == WHITE) this->generateLegalMoves<WHITE>(~0ULL, kinds, moves);
+	else this->generateLegalMoves<BLACK>(~0ULL, kinds, moves);
+	PROFILE_VALUE(LEGALMOVES, moves.size());
+}
+
+void Board::getLegalMoves(Coordinates piece, MoveList &moves) {
+	PROFILE_SCOPE(GETLEGALMOVES);
+	if (this->pieceOn(piece.toSquare()) == EMPTY) return;
+	if (this->getSide(piece) == WHITE) this->generateLegalMoves<WHITE>(squareBB(piece.toSquare()), ALLMOVES, moves);
+	else this->generateLegalMoves<BLACK>(squareBB(piece.toSquare()), ALLMOVES, moves);
+}
+
+// only the moving piece's moves are generated, of the kind the move is
+bool Board::isLegal(Move move) {
+	uint8_t piece = this->pieceOn(move.from());
+	if (move == Move::none() || piece == EMPTY || (piece > WKING) != this->toPlay) return false;
+	MoveList moves;
+	uint8_t kind = this->isNoisy(move) ? NOISY : QUIET;
+	if (this->toPlay == WHITE) this->generateLegalMoves<WHITE>(squareBB(move.from()), kind, moves);
+	else this->generateLegalMoves<BLACK>(squareBB(move.from()), kind, moves);
+	return moves.contains(move);
+}
+
+std::string Board::toUCI(Move move) {
+	std::string name = "";
+	name += (char)(move.from() % 8 + 'a');
+	name += (char)(move.from() / 8 + '1');
+	name += (char)(move.to() % 8 + 'a');
+	name += (char)(move.to() / 8 + '1');
+	if (move.type() == Move::PROMOTION) name += pieces[move.promotion() + WKING];
+	return name;
+}
+
+std::string Board::toSAN(Move move) {
+	PROFILE_SCOPE(TOSAN);
+	uint8_t from = move.from();
+	uint8_t to = move.to();
+	uint8_t type = pieceType(this->pieceOn(from));
+	bool capture = move.type() == Move::ENPASSANT || (this->pieceOn(to) != EMPTY && move.type() != Move::CASTLING);
+	std::string name = "";
+	if (move.type() == Move::CASTLING) {
+		name = to > from ? "O-O" : "O-O-O";
+	} else if (type == PAWN) {
+		if (capture) {
+			name += (char)(from % 8 + 'a');
+			name += 'x';
+		}
+		name += (char)(to % 8 + 'a');
+		name += (char)(to / 8 + '1');
+		if (move.type() == Move::PROMOTION) {
+			name += '=';
+			name += pieces[move.promotion()];
+		}
+	} else {
+		name += pieces[type];
+		// name the file, else the rank, else both, when another piece of the same kind can go there too
+		MoveList moves;
+		this->getLegalMoves(moves);
+		bool ambiguous = false, sameFile = false, sameRank = false;
+		for (Move other : moves) {
+			if (other.to() != to || other.from() == from || pieceType(this->pieceOn(other.from())) != type) continue;
+			ambiguous = true;
+			if (other.from() % 8 == from % 8) sameFile = true;
+			if (other.from() / 8 == from / 8) sameRank = true;
+		}
+		if (ambiguous && (!sameFile || sameRank)) name += (char)(from % 8 + 'a');
+		if (ambiguous && sameFile) name += (char)(from / 8 + '1');
+		if (capture) name += 'x';
+		name += (char)(to % 8 + 'a');
+		name += (char)(to / 8 + '1');
+	}
+	this->play(move);
+	if (this->isInCheck(this->toPlay)) {
+		MoveList replies;
+		this->getLegalMoves(replies);
+		name += replies.size() == 0 ? '#' : '+';
+	}
+	this->unplay();
+	return name;
+}
+
+Move Board::fromSAN(std::string_view san) {
+	while (!san.empty() && strchr("+#!?", san.back())) san.remove_suffix(1);
+	MoveList moves;
+	this->getLegalMoves(moves);
+	if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+		uint8_t file = san.size() == 3 ? 6 : 2;
+		for (Move move : moves) {
+			if (move.type() == Move::CASTLING && move.to() % 8 == file) return move;
+		}
+		return Move::none();
+	}
+
+	uint8_t type = PAWN, promotion = 0;
+	if (!san.empty() && strchr("NBRQK", san.front())) {
+		type = strchr(pieces, san.front()) - pieces;
+		san.remove_prefix(1);
+	}
+	// e8=Q, but also e8Q and e8=q
+	if (type == PAWN && !san.empty() && strchr("NBRQnbrq", san.back())) {
+		promotion = pieceType(strchr(pieces, san.back()) - pieces);
+		san.remove_suffix(1);
+		if (!san.empty() && san.back() == '=') san.remove_suffix(1);
+	}
+	if (san.size() < 2) return Move::none();
+	char toFile = san[san.size() - 2], toRank = san[san.size() - 1];
+	if (toFile < 'a' || toFile > 'h' || toRank < '1' || toRank > '8') return Move::none();
+	uint8_t to = (toRank - '1') * 8 + toFile - 'a';
+	int fromFile = -1, fromRank = -1;
+	for (char c : san.substr(0, san.size() - 2)) {
+		if (c >= 'a' && c <= 'h') fromFile = c - 'a';
+		else if (c >= '1' && c <= '8') fromRank = c - '1';
+		else if (c != 'x') return Move::none();
+	}
+
+	Move found = Move::none();
+	for (Move move : moves) {
+		if (move.to() != to || move.type() == Move::CASTLING || pieceType(this->pieceOn(move.from())) != type) continue;
+		if (fromFile != -1 && move.from() % 8 != fromFile) continue;
+		if (fromRank != -1 && move.from() / 8 != fromRank) continue;
+		if ((move.type() == Move::PROMOTION ? move.promotion() : 0) != promotion) continue;
+		if (found != Move::none()) return Move::none();
+		found = move;
+	}
+	return found;
+}
+
+bool Board::getSide(Coordinates coords) {
+	return (this->pieceOn(coords.toSquare()) > WKING);
+}
+
+// the castling rights a move gives up by starting or ending on a square, a king's or a rook's home
+static constexpr std::array<uint8_t, 64> castlingLoss = []() {
+	std::array<uint8_t, 64> loss = {};
+	loss[4] = 3;
+	loss[7] = 1;
+	loss[0] = 2;
+	loss[60] = 12;
+	loss[63] = 4;
+	loss[56] = 8;
+	return loss;
+}();
+
+void Board::play(Move move) {
+	PROFILE_SCOPE(PLAY);
+	if (this->toPlay == WHITE) this->playMove<WHITE>(move);
+	else this->playMove<BLACK>(move);
+}
+
+template <bool side>
+void Board::playMove(Move move) {
+	typedef SideInfo<side> Us;
+	uint8_t from = move.from();
+	uint8_t to = move.to();
+	uint8_t moving = this->pieceOn(from);
+	UndoInfo undo;
+	undo.move = move;
+	undo.captured = move.type() == Move::ENPASSANT ? makePiece(Us::THEM, PAWN) : this->pieceOn(to);
+	undo.castlingRights = this->castlingRights;
+	undo.enPassantFlag = this->enPassantFlag;
+	undo.pliesForDraw = this->pliesForDraw;
+	undo.key = this->key;
+	this->undoStack.push_back(undo);
+	PROFILE_VALUE(UNDOSTACK, this->undoStack.size());
+	if (this->enPassantFlag != -1) this->key ^= Zobrist::keys.enPassant[this->enPassantFlag];
+	if (move.type() == Move::ENPASSANT) {
+		this->removePiece(to - Us::UP);
+	}
+	this->key ^= Zobrist::keys.castling[this->castlingRights];
+	this->castlingRights &= ~(castlingLoss[from] | castlingLoss[to]);
+	this->key ^= Zobrist::keys.castling[this->castlingRights];
+	if (move.type() == Move::CASTLING && to > from) {
+		uint8_t rook = this->pieceOn(to + 1);
+		this->removePiece(to + 1);
+		this->putPiece(to - 1, rook);
+		this->pliesForDraw++;
+	} else if (move.type() == Move::CASTLING) {
+		uint8_t rook = this->pieceOn(to - 2);
+		this->removePiece(to - 2);
+		this->putPiece(to + 1, rook);
+		this->pliesForDraw++;
+	} else if (move.type() == Move::PROMOTION) {
+		moving = makePiece(side, move.promotion());
+		this->pliesForDraw = 0;
+	} else {
+		if (moving == Us::PAWN || this->pieceOn(to) != EMPTY) {
+			this->pliesForDraw = 0;
+		} else {
+			this->pliesForDraw++;
+		}
+	}
+	if (this->pieceOn(to) != EMPTY) this->removePiece(to);
+	this->removePiece(from);
+	this->putPiece(to, moving);
+	this->enPassantFlag = -1;
+	// only flag en passant when a pawn can actually take, so the key doesn't tell apart identical positions
+	if (moving == Us::PAWN && (from ^ to) == 16
+		&& (pawnAttacks[side][from + Us::UP] & this->getPieces(Us::THEM, PAWN))) {
+		this->enPassantFlag = to % 8;
+		this->key ^= Zobrist::keys.enPassant[this->enPassantFlag];
+	}
+	this->key ^= Zobrist::keys.side;
+	this->moveCount++;
+	this->toPlay = Us::THEM;
+}
+
+void Board::unplay() {
+	PROFILE_SCOPE(UNPLAY);
+	UndoInfo undo = this->undoStack.back();
+	this->undoStack.pop_back();
+	// the side that made the move
+	if (this->toPlay == WHITE) this->unplayMove<BLACK>(undo);
+	else this->unplayMove<WHITE>(undo);
+}
+
+template <bool side>
+void Board::unplayMove(const UndoInfo &undo) {
+	typedef SideInfo<side> Us;
+	this->toPlay = side;
+	this->moveCount--;
+	uint8_t from = undo.move.from();
+	uint8_t to = undo.move.to();
+	if (undo.move.type() == Move::CASTLING) {
+		uint8_t rookFrom = to > from ? to + 1 : to - 2;
+		uint8_t rookTo = to > from ? to - 1 : to + 1;
+		this->removePiece(rookTo);
+		this->putPiece(rookFrom, Us::ROOK);
+	}
+	uint8_t moved = undo.move.type() == Move::PROMOTION ? Us::PAWN : this->pieceOn(to);
+	this->removePiece(to);
+	this->putPiece(from, moved);
+	if (undo.move.type() == Move::ENPASSANT) {
+		this->putPiece(to - Us::UP, undo.captured);
+	} else if (undo.captured != EMPTY) {
+		this->putPiece(to, undo.captured);
+	}
+	this->castlingRights = undo.castlingRights;
+	this->enPassantFlag = undo.enPassantFlag;
+	this->pliesForDraw = undo.pliesForDraw;
+	this->key = undo.key;
+}
+
+// Neither side can mate: kings alone, a single minor piece, or bishops that all stand on one color.
+bool Board::hasInsufficientMaterial() const {
+	if (this->byType[PAWN] | this->byType[ROOK] | this->byType[QUEEN]) return false;
+	Bitboard minors = this->byType[KNIGHT] | this->byType[BISHOP];
+	if (Bitboards::popCount(minors) <= 1) return true;
+	constexpr Bitboard DARKSQUARES = 0xAA55AA55AA55AA55ULL;
+	return !this->byType[KNIGHT] && (!(minors & DARKSQUARES) || !(minors & ~DARKSQUARES));
+}
+
+uint8_t Board::playRandomMove(Rng &rng) {
+	PROFILE_SCOPE(PLAYRANDOMMOVE);
+	Move move = this->randomLegalMove(rng);
+	if (move == Move::none()) {
+		if (!this->isInCheck(this->toPlay)) return STALEMATE;
+		return this->toPlay == WHITE ? BLACKWINS : WHITEWINS;
+	}
+	if (this->pliesForDraw >= 150) return SEVENTYFIVEMOVES;
+	// the same position can come back after four plies at the earliest, so three times takes eight
+	if (this->pliesForDraw >= 8 && this->repetitionCount() >= 2) return REPETITION;
+	if (this->hasInsufficientMaterial()) return INSUFFICIENTMATERIAL;
+	this->play(move);
+	return ONGOING;
+}
+
+uint8_t Board::playout(Rng &rng) {
+	uint8_t result;
+	while ((result = this->playRandomMove(rng)) == ONGOING) {}
+	return result;
+}
+
+uint8_t Board::getResult() {
+	PROFILE_SCOPE(GETRESULT);
+	MoveList moves;
+	this->getLegalMoves(moves);
+	if (moves.size() == 0) {
+		if (!this->isInCheck(this->toPlay)) return STALEMATE;
+		return this->toPlay == WHITE ? BLACKWINS : WHITEWINS;
+	}
+	if (this->pliesForDraw >= 150) return SEVENTYFIVEMOVES;
+	if (this->repetitionCount() >= 2) return REPETITION;
+	if (this->hasInsufficientMaterial()) return INSUFFICIENTMATERIAL;
+	return ONGOING;
+}
+
+std::string Board::describeResult(uint8_t result) {
+	switch (result) {
+		case WHITEWINS:
+			return "Checkmate. White wins.";
+		case BLACKWINS:
+			return "Checkmate. Black wins.";
+		case STALEMATE:
+			return "Stalemate. Draw.";
+		case SEVENTYFIVEMOVES:
+			return "75 moves since last pawn move or capture. Draw.";
+		case REPETITION:
+			return "Threefold repetition. Draw.";
+		case TABLEBASEDRAW:
+			return "Drawn endgame according to the tablebase.";
+		case DRAW:
+			return "Draw.";
+		case INSUFFICIENTMATERIAL:
+			return "Insufficient material. Draw.";
+	}
+	return "Game in progress.";
+}
+
+// Adds everything up again, to check the running sums against.
+int Board::evaluateFromScratch() const {
+	int mg = 0, eg = 0, gamePhase = 0;
+	for (int square = 0; square < 64; square++) {
+		mg += Eval::tables.mg[this->pieceOn(square)][square];
+		eg += Eval::tables.eg[this->pieceOn(square)][square];
+		gamePhase += Eval::tables.phase[this->pieceOn(square)];
+	}
+	int score = Eval::taper(mg, eg, gamePhase);
+	return this->toPlay == WHITE ? score : -score;
+}
+
+void Board::clearPosition() {
+	for (int i = 0; i < 32; i++) {
+		this->mailbox[i] = 0;
+	}
+	for (int i = 0; i < 7; i++) {
+		this->byType[i] = 0;
+	}
+	this->byColor[WHITE] = 0;
+	this->byColor[BLACK] = 0;
+	this->mgScore = 0;
+	this->egScore = 0;
+	this->phase = 0;
+	this->key = this->computeKey();
+	this->undoStack.clear();
+}
+
+void Board::setCastlingRights(uint8_t rights) {
+	this->castlingRights = rights & 15;
+}
+
+uint64_t Board::computeKey() const {
+	uint64_t fullKey = 0;
+	for (int square = 0; square < 64; square++) {
+		fullKey ^= Zobrist::keys.pieces[this->pieceOn(square)][square];
+	}
+	fullKey ^= Zobrist::keys.castling[this->getCastlingRights()];
+	if (this->enPassantFlag != -1) fullKey ^= Zobrist::keys.enPassant[this->enPassantFlag];
+	if (this->toPlay == BLACK) fullKey ^= Zobrist::keys.side;
+	return fullKey;
+}
+
+// Positions can only repeat since the last capture or pawn move, and only with the same side to move.
+int Board::repetitionCount() const {
+	PROFILE_SCOPE(REPETITIONCOUNT);
+	int count = 0;
+	int size = this->undoStack.size();
+	int window = std::min<int>(this->pliesForDraw, size);
+	PROFILE_VALUE(REPETITIONWINDOW, window);
+	// two plies back can't be the same position, each side would have had to move and take it back
+	for (int i = 4; i <= window; i += 2) {
+		if (this->undoStack[size - i].key == this->key) count++;
+	}
+	return count;
+}
+
+void Board::print() {
+	std::cout << "Turn " << (this->moveCount / 2) + 1 << " (" << (this->toPlay == WHITE ? "white" : "black") << " to move); " << (int)this->pliesForDraw << " plies since last capture or pawn move." << std::endl;
+	std::cout << "a b c d e f g h" << std::endl << std::endl;
+	for (int i = 7; i >= 0; i--) {
+		for (int j = 0; j < 8; j++) {
+			std::cout << this->pieces[this->pieceOn(i * 8 + j)] << " ";
+		}
+		std::cout << " " << i + 1 << std::endl;
+	}
+	std::cout << "------------------" << std::endl;
+}
+
+void Board::setPiece(Coordinates coords, uint8_t piece) {
+	uint8_t square = coords.toSquare();
+	if (this->pieceOn(square) != EMPTY) this->removePiece(square);
+	if (piece != EMPTY) this->putPiece(square, piece);
+}
+
+// Splits off the next space separated field, an empty view once the text runs out.
+static std::string_view nextField(std::string_view &text) {
+	size_t start = text.find_first_not_of(" \t");
+	if (start == std::string_view::npos) {
+		text = std::string_view();
+		return text;
+	}
+	size_t end = text.find_first_of(" \t", start);
+	if (end == std::string_view::npos) end = text.size();
+	std::string_view field = text.substr(start, end - start);
+	text.remove_prefix(end);
+	return field;
+}
+
+static bool parseNumber(std::string_view field, int &value) {
+	auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+	return error == std::errc() && end == field.data() + field.size();
+}
+
+bool Board::loadFromFEN(std::string_view fen) {
+	// nothing may follow the counters
+	if (this->parsePosition(fen) && nextField(fen).empty()) return true;
+	this->clearPosition();
+	return false;
+}
+
+bool Board::loadFromEPD(std::string_view line) {
+	if (this->parsePosition(line)) return true;
+	this->clearPosition();
+	return false;
+}
+
+// Parses the four position fields and, when they're there, the two counters, and
+// leaves whatever follows (EPD operations, or junk) in text. Returns false on
+// anything that isn't a legal position, the board is in no useful state then.
+bool Board::parsePosition(std::string_view &text) {
+	this->clearPosition();
+	this->enPassantFlag = -1;
+	this->setCastlingRights(0);
+	this->moveCount = 0;
+	this->pliesForDraw = 0;
+	this->toPlay = WHITE;
+
+	std::string_view placement = nextField(text);
+	int rank = 7, file = 0;
+	char previous = '/';
+	for (char c : placement) {
+		// "71" adds up to a full rank as well, but isn't FEN
+		if (c >= '1' && c <= '8' && previous >= '1' && previous <= '8') return false;
+		previous = c;
+		if (c == '/') {
+			if (file != 8 || rank == 0) return false;
+			rank--;
+			file = 0;
+		} else if (c >= '1' && c <= '8') {
+			file += c - '0';
+			if (file > 8) return false;
+		} else {
+			const char *piece = std::strchr(pieces + 1, c);
+			if (c == '\0' || !piece || file > 7) return false;
+			this->putPiece(rank * 8 + file, piece - pieces);
+			file++;
+		}
+	}
+	if (rank != 0 || file != 8) return false;
+	if (popCount(this->getPieces(WHITE, KING)) != 1 || popCount(this->getPieces(BLACK, KING)) != 1) return false;
+
+	std::string_view side = nextField(text);
+	if (side == "w") this->toPlay = WHITE;
+	else if (side == "b") this->toPlay = BLACK;
+	else return false;
+
+	std::string_view castling = nextField(text);
+	uint8_t rights = 0;
+	if (castling != "-") {
+		if (castling.empty()) return false;
+		for (char c : castling) {
+			const char *right = std::strchr("KQkq", c);
+			if (c == '\0' || !right || (rights & (1 << (right - "KQkq")))) return false;
+			rights |= 1 << (right - "KQkq");
+		}
+	}
+
+	std::string_view enPassant = nextField(text);
+	int8_t enPassantFile = -1;
+	if (enPassant != "-") {
+		if (enPassant.size() != 2 || enPassant[0] < 'a' || enPassant[0] > 'h') return false;
+		if (enPassant[1] != (this->toPlay == WHITE ? '6' : '3')) return false;
+		enPassantFile = enPassant[0] - 'a';
+	}
+	if (!this->isConsistent(rights, enPassantFile)) return false;
+	this->setCastlingRights(rights);
+	// like play(), only keep the flag when a pawn can actually take
+	if (enPassantFile != -1) {
+		uint8_t target = (this->toPlay == WHITE ? 40 : 16) + enPassantFile;
+		if (pawnAttacks[!this->toPlay][target] & this->getPieces(this->toPlay, PAWN)) this->enPassantFlag = enPassantFile;
+	}
+
+	// the counters are optional, EPD lines don't have them
+	std::string_view rest = text;
+	std::string_view halfMoveField = nextField(rest);
+	int halfMoves = 0, fullMoves = 1;
+	if (parseNumber(halfMoveField, halfMoves)) {
+		std::string_view fullMoveField = nextField(rest);
+		if (!parseNumber(fullMoveField, fullMoves)) return false;
+		// past 150 the game is over by the 75-move rule. No game gets anywhere
+		// near 65535 moves, which is also all a packed record holds.
+		if (halfMoves < 0 || halfMoves > 150 || fullMoves < 1 || fullMoves > 65535) return false;
+		text = rest;
+	}
+	this->pliesForDraw = halfMoves;
+	this->moveCount = (fullMoves - 1) * 2 + (this->toPlay == BLACK);
+	this->key = this->computeKey();
+	return true;
+}
+
+bool Board::isConsistent(uint8_t rights, int8_t enPassantFile) const {
+	if (this->byType[PAWN] & (RANK_1 | RANK_8)) return false;
+	// the side that just moved can't have left its king in check
+	if (this->attackersTo(this->kingSquare(!this->toPlay), this->byType[ALLPIECES]) & this->byColor[this->toPlay]) return false;
+	// a right needs its king and rook still at home
+	if ((rights & 3) && this->pieceOn(4) != WKING) return false;
+	if ((rights & 12) && this->pieceOn(60) != BKING) return false;
+	if (((rights & 1) && this->pieceOn(7) != WROOK) || ((rights & 2) && this->pieceOn(0) != WROOK)) return false;
+	if (((rights & 4) && this->pieceOn(63) != BROOK) || ((rights & 8) && this->pieceOn(56) != BROOK)) return false;
+	if (enPassantFile != -1) {
+		if (enPassantFile > 7) return false;
+		int target = (this->toPlay == WHITE ? 40 : 16) + enPassantFile;
+		int pushed = this->toPlay == WHITE ? target - 8 : target + 8;
+		int origin = this->toPlay == WHITE ? target + 8 : target - 8;
+		if (this->pieceOn(pushed) != makePiece(!this->toPlay, PAWN) || this->pieceOn(target) != EMPTY || this->pieceOn(origin) != EMPTY) return false;
+	}
+	return true;
+}
+
+std::string Board::exportFEN() {
+	std::string fen = "";
+	for (int i = 7; i >= 0; i--) {
+		int emptySquareCount = 0;
+		for (int j = 0; j < 8; j++) {
+			if (this->pieceOn(i * 8 + j) == EMPTY) {
+				emptySquareCount++;
+			} else {
+				if (emptySquareCount > 0) {
+					fen += std::to_string(emptySquareCount);
+					emptySquareCount = 0;
+				}
+				fen += this->pieces[this->pieceOn(i * 8 + j)];
+			}
+		}
+		if (emptySquareCount > 0) {
+			fen += std::to_string(emptySquareCount);
+		}
+		fen += '/';
+	}
+	fen.pop_back();
+	fen += (this->toPlay == WHITE ? " w " : " b ");
+	if (this->castlingRights & 1) fen += 'K';
+	if (this->castlingRights & 2) fen += 'Q';
+	if (this->castlingRights & 4) fen += 'k';
+	if (this->castlingRights & 8) fen += 'q';
+	if (fen.back() == ' ') fen += '-';
+
+	fen += ' ';
+	if (this->enPassantFlag != -1) {
+		fen += (this->enPassantFlag + 'a');
+		fen += (this->toPlay == WHITE ? "6 " : "3 ");
+	} else {
+		fen += "- ";
+	}
+	fen += std::to_string((int)pliesForDraw);
+	fen += ' ';
+	fen += std::to_string(moveCount / 2 + 1);
+	return fen;
+}
@@ -0,0 +1,177 @@
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bitboard.h"
+#include "eval.h"
+#include "move.h"
+#include "position.h"
+#include "random.h"
+
+struct PackedPosition;
+struct SearchLimits;
+struct SearchResult;
+class TranspositionTable;
+
+struct Coordinates {
+	uint8_t file, rank;
+	Coordinates(uint8_t nFile = 0, uint8_t nRank = 0) {
+		this->file = nFile;
+		this->rank = nRank;
+	}
+	bool operator==(Coordinates other) {
+		return (this->file == other.file && this->rank == other.rank);
+	}
+	uint8_t toSquare() const {
+		return this->rank * 8 + this->file;
+	}
+	static Coordinates fromSquare(uint8_t square) {
+		return Coordinates(square % 8, square / 8);
+	}
+}; // struct Coordinates
+
+// What play() can't recompute when taking a move back.
+struct UndoInfo {
+	Move move;
+	uint8_t captured;
+	uint8_t castlingRights;
+	int8_t enPassantFlag;
+	uint16_t pliesForDraw;
+	uint64_t key;
+}; // struct UndoInfo
+
+// A game in progress: the position (see position.h) and the moves that led to it,
+// which repetition detection and unplay() need.
+class Board : public Position {
+	public:
+		Board();
+		void setStartingPosition();
+		// Copies the position and its move history, e.g. to give a search thread its own board.
+		void copyPosition(const Board &other);
+		// starts from a bare position with no history
+		void setPosition(const Position &position);
+		// Goes back to a position earlier in this same game, the one after plies moves,
+		// without taking the moves back one by one.
+		void rewind(const Position &position, size_t plies);
+		Bitboard getAttacks(Coordinates piece);
+		bool attacks(Coordinates piece, Coordinates target);
+		// every piece of either color that attacks square, with sliders seen through the pieces missing from occupied
+		Bitboard attackersTo(uint8_t square, Bitboard occupied) const;
+		// Static exchange evaluation: the material the side making the capture wins on
+		// move.to(), or loses when negative, if both sides keep taking there with their
+		// least valuable piece and each may stop whenever it likes. Sliders behind the
+		// pieces that took join in. Pins and checks are ignored. 0 for quiet moves.
+		int see(Move move) const;
+		bool isInCheck(bool side);
+		void getLegalMoves(MoveList &moves);
+		// only the kinds of moves asked for, NOISY, QUIET or both
+		void getLegalMoves(MoveList &moves, uint8_t kinds);
+		void getLegalMoves(Coordinates piece, MoveList &moves);
+		// whether a move that comes from elsewhere, e.g. the transposition table, can be played here
+		bool isLegal(Move move);
+		// captures and promotions
+		bool isNoisy(Move move) const {
+			return move.type() == Move::PROMOTION || move.type() == Move::ENPASSANT
+				|| (this->pieceOn(move.to()) != EMPTY && move.type() != Move::CASTLING);
+		}
+		bool getSide(Coordinates coords);
+		void play(Move move);
+		void unplay();
+		// The rollout kernel: plays a uniformly random legal move and returns ONGOING, or
+		// returns how the game ended without moving. Cheaper than getLegalMoves() and getResult().
+		uint8_t playRandomMove(Rng &rng);
+		// random moves until the game is over, returns the result
+		uint8_t playout(Rng &rng);
+		// Move::none() when there is no legal move
+		Move randomLegalMove(Rng &rng);
+		bool hasInsufficientMaterial() const;
+		uint8_t getResult();
+		static std::string describeResult(uint8_t result);
+		void print();
+		void clearPosition();
+		void setPiece(Coordinates coords, uint8_t piece);
+		// Strict: the halfmove and fullmove counters may be left out, anything else wrong
+		// (or a position that can't come up in a game) fails and leaves the board empty.
+		bool loadFromFEN(std::string_view fen);
+		// the four position fields of an EPD line, the operations after them are ignored
+		bool loadFromEPD(std::string_view line);
+		std::string exportFEN();
+		// the position in 32 bytes, see packed.h
+		PackedPosition pack(int16_t score = 0, uint8_t result = ONGOING) const;
+		bool unpack(const PackedPosition &packed);
+		int repetitionCount() const;
+		// tapered material and piece-square score for the side to move, in centipawns, see eval.h
+		int evaluate() const {
+			int score = Eval::taper(this->mgScore, this->egScore, this->phase);
+			return this->toPlay == WHITE ? score : -score;
+		}
+		int evaluateFromScratch() const;
+		// alpha-beta search from the current position, see search.h
+		SearchResult search(const SearchLimits &limits, TranspositionTable &tt);
+
+		// game results, see getResult()
+		static constexpr uint8_t ONGOING = 0;
+		static constexpr uint8_t WHITEWINS = 1;
+		static constexpr uint8_t BLACKWINS = 2;
+		static constexpr uint8_t STALEMATE = 3;
+		static constexpr uint8_t SEVENTYFIVEMOVES = 4;
+		static constexpr uint8_t REPETITION = 5;
+		// never returned by getResult(), for games stopped early in a drawn tablebase ending
+		static constexpr uint8_t TABLEBASEDRAW = 6;
+		// never returned by getResult(), for a draw we only know from a game record such as a PGN
+		static constexpr uint8_t DRAW = 7;
+		static constexpr uint8_t INSUFFICIENTMATERIAL = 8;
+		static constexpr uint8_t RESULTCOUNT = 9;
+
+		// kinds of moves for getLegalMoves()
+		static constexpr uint8_t NOISY = 1;
+		static constexpr uint8_t QUIET = 2;
+		static constexpr uint8_t ALLMOVES = NOISY | QUIET;
+
+		// rough values for exchanges and capture ordering, by piece type, the king worth more than everything else
+		static constexpr int PIECEVALUES[7] = {0, 100, 320, 330, 500, 900, 20000};
+
+		static std::string toUCI(Move move);
+		// standard algebraic notation of a legal move in this position, with + or # when it checks or mates
+		std::string toSAN(Move move);
+		// the legal move a SAN token stands for, check marks and annotations allowed, Move::none() when there is none or it's ambiguous
+		Move fromSAN(std::string_view san);
+		Move lastMove() const {
+			return this->undoStack.back().move;
+		}
+		// the moves played so far and the keys before them, oldest first
+		const std::vector<UndoInfo> &getHistory() const {
+			return this->undoStack;
+		}
+	private:
+		void putPiece(uint8_t square, uint8_t piece);
+		void removePiece(uint8_t square);
+		uint64_t computeKey() const;
+		bool parsePosition(std::string_view &text);
+		// The checks a loaded position has to pass beyond its pieces, shared by the
+		// FEN parser and unpack(): the side that just moved isn't in check, no pawn
+		// is on the first or last rank, every castling right has its king and rook
+		// at home and an en passant file has the pawn that just moved two squares.
+		bool isConsistent(uint8_t rights, int8_t enPassantFile) const;
+		void setCastlingRights(uint8_t rights);
+		void addPawnMoves(MoveList &moves, uint8_t from, Bitboard targets);
+		// Move generation and making moves are compiled once per side to move, the
+		// public functions above only pick the instance.
+		template <bool side> void generateLegalMoves(Bitboard fromMask, uint8_t kinds, MoveList &moves);
+		template <bool side> Move pickRandomMove(Rng &rng);
+		template <bool side> void playMove(Move move);
+		template <bool side> void unplayMove(const UndoInfo &undo);
+		template <bool side> Bitboard pinnedPieces(uint8_t king) const;
+		template <bool side> Bitboard pieceTargets(uint8_t from, Bitboard allowed) const;
+		template <bool side> bool enPassantIsLegal(uint8_t from);
+		template <bool side> bool castlingIsLegal(bool kingSide);
+
+		// one entry per move played, also holds the keys for repetition detection
+		std::vector<UndoInfo> undoStack;
+}; // class Board
+
+#endif
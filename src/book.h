@@ -0,0 +1,83 @@
+#ifndef BOOK_H
+#define BOOK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "mappedfile.h"
+#include "random.h"
+
+// Polyglot opening books: a sorted array of 16-byte big-endian entries, each a
+// position key, a move and a weight. The keys come from a fixed table of 781
+// random numbers that every Polyglot book is made with.
+namespace Polyglot {
+	static constexpr int RANDOMCOUNT = 781;
+	static constexpr int CASTLINGOFFSET = 768;
+	static constexpr int ENPASSANTOFFSET = 772;
+	static constexpr int TURNOFFSET = 780;
+
+	uint64_t keyOf(const Board &board);
+	// castling as the king taking its own rook, promotions 1 (knight) to 4 (queen) in bits 12-14
+	uint16_t encodeMove(Move move);
+	// the legal move matching a book move, Move::none() when there is none
+	Move decodeMove(Board &board, uint16_t move);
+} // namespace Polyglot
+
+struct BookEntry {
+	uint64_t key;
+	uint16_t move;
+	uint16_t weight;
+	uint32_t learn;
+}; // struct BookEntry
+
+// A Polyglot book mapped into memory, looked up by binary search.
+class OpeningBook {
+	public:
+		static constexpr size_t ENTRYSIZE = 16;
+
+		bool open(const std::string &path);
+		void close();
+		bool isOpen() const {
+			return this->file.isOpen();
+		}
+		size_t size() const {
+			return this->file.getSize() / ENTRYSIZE;
+		}
+		BookEntry entry(size_t index) const;
+		// every entry for the position, in book order
+		void probe(const Board &board, std::vector<BookEntry> &entries) const;
+		// a legal book move chosen with probability proportional to its weight, Move::none() when out of book
+		Move pick(Board &board, Rng &rng) const;
+	private:
+		size_t lowerBound(uint64_t key) const;
+
+		MappedFile file;
+}; // class OpeningBook
+
+struct BookBuildOptions {
+	int maxPly = 40;
+	// moves played in fewer games than this are left out
+	uint32_t minGames = 1;
+	// how much the sort may hold in memory before it spills a run to disk
+	size_t memoryMB = 256;
+}; // struct BookBuildOptions
+
+struct BookBuildStats {
+	uint64_t games = 0;
+	uint64_t invalid = 0;
+	uint64_t positions = 0;
+	uint64_t entries = 0;
+	int runs = 0;
+	double seconds = 0;
+}; // struct BookBuildStats
+
+// Compiles PGN files into a book. Every position up to maxPly becomes a record,
+// records are sorted in memory sized runs that go to temporary files next to
+// the output, and the runs are merged at the end, so the games may take up far
+// more than RAM. A move's weight is 2 per win and 1 per draw for the side that
+// played it, scaled down if needed to fit in 16 bits.
+bool buildBook(const std::vector<std::string> &pgnPaths, const std::string &output, const BookBuildOptions &options, BookBuildStats &stats);
+
+#endif
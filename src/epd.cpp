@@ -0,0 +1,71 @@
+#include "epd.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#include "mappedfile.h"
+
+// big enough that threads rarely meet at the chunk counter, small enough to share the work out evenly
+static constexpr size_t CHUNKSIZE = 4 << 20;
+
+bool loadPositions(const std::string &path, int threads, const PositionCallback &onPosition, EpdStats &stats) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(path)) return false;
+	std::string_view text = file.view();
+	size_t chunks = (text.size() + CHUNKSIZE - 1) / CHUNKSIZE;
+	std::atomic<size_t> nextChunk(0);
+	std::atomic<uint64_t> positions(0), invalid(0);
+
+	// A line belongs to the chunk it starts in, even when it runs on into the next one.
+	auto worker = [&](int thread) {
+		Board board;
+		uint64_t localPositions = 0, localInvalid = 0;
+		while (true) {
+			size_t chunk = nextChunk.fetch_add(1, std::memory_order_relaxed);
+			if (chunk >= chunks) break;
+			size_t position = chunk * CHUNKSIZE;
+			size_t end = std::min(position + CHUNKSIZE, text.size());
+			if (position > 0 && text[position - 1] != '\n') {
+				const char *newline = (const char *)std::memchr(text.data() + position, '\n', text.size() - position);
+				position = newline ? newline - text.data() + 1 : text.size();
+			}
+			while (position < end) {
+				const char *newline = (const char *)std::memchr(text.data() + position, '\n', text.size() - position);
+				size_t lineEnd = newline ? newline - text.data() : text.size();
+				std::string_view line = text.substr(position, lineEnd - position);
+				position = lineEnd + 1;
+				if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+				size_t first = line.find_first_not_of(" \t");
+				if (first == std::string_view::npos || line[first] == '#') continue;
+				if (!board.loadFromEPD(line)) {
+					localInvalid++;
+					continue;
+				}
+				localPositions++;
+				onPosition(board, line, thread);
+			}
+		}
+		positions += localPositions;
+		invalid += localInvalid;
+	};
+
+	if (threads < 1) threads = 1;
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++) {
+		pool.emplace_back(worker, i);
+	}
+	worker(0);
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+	stats.positions = positions;
+	stats.invalid = invalid;
+	stats.bytes = text.size();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
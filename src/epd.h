@@ -0,0 +1,28 @@
+#ifndef EPD_H
+#define EPD_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+#include "board.h"
+
+struct EpdStats {
+	uint64_t positions = 0;
+	uint64_t invalid = 0;
+	uint64_t bytes = 0;
+	double seconds = 0;
+}; // struct EpdStats
+
+// Called once for every position: the thread's own board with the position
+// loaded, the whole line (for the EPD operations) and the thread index.
+typedef std::function<void(Board &board, std::string_view line, int thread)> PositionCallback;
+
+// Reads a file of EPD or FEN lines, one position per line, blank lines and
+// lines starting with # skipped. The file is memory mapped and cut into chunks
+// at line boundaries that the threads take in turn, so the callback runs on
+// several threads at once and positions arrive in no particular order.
+bool loadPositions(const std::string &path, int threads, const PositionCallback &onPosition, EpdStats &stats);
+
+#endif
@@ -1,745 +1,296 @@
+#include <atomic>
 #include <iostream>
-#include <vector>
-#include <thread>
-#include <chrono>
+#include <iomanip>
+#include <cstdlib>
+#include <ctime>
 #include <string>
-#include <sstream>
-#include <iterator>
-#include <fstream>
+#include <thread>
+
+#include "board.h"
+#include "epd.h"
+#include "mcts.h"
+#include "packed.h"
+#include "pgn.h"
+#include "selfplay.h"
+#include "search.h"
+#include "tt.h"
+#include "uci.h"
 
 //  So I'm just writing everything wrong with this code here
 // 1. The semantics are horrible
-// 2. During checkmate/stalemate, Board::toPlay seems to be wrong.
-// 3. Make sure the 75 (or 50) move rule checks for checkmates, stalemates, captures or pawn moves at the last move
-// 4. Threefold repetition isn't implemented
-// 5. Draw by insufficient material isn't implemented
-// 6. Board::play assumes the move is legal, which may or may not be a good thing
-// 7. The semantics are horrible
-// 8. The semantics are horrible
-// 9. The semantics are horrible
+// 2. Make sure the 75 (or 50) move rule checks for checkmates, stalemates, captures or pawn moves at the last move
+// 3. Board::play assumes the move is legal, which may or may not be a good thing
+// 4. The semantics are horrible
+// 5. The semantics are horrible
+// 6. The semantics are horrible
 
-struct Coordinates {
-	uint8_t file, rank;
-	uint8_t promotion = 0;
-	Coordinates(uint8_t nFile = 0, uint8_t nRank = 0, uint8_t nPromotion = 0) {
-		this->file = nFile;
-		this->rank = nRank;
-		this->promotion = nPromotion;
-	}
-	bool operator==(Coordinates other) {
-		return (this->file == other.file && this->rank == other.rank);
+static int playOneGame() {
+	Rng rng(time(NULL));
+	Board board;
+	board.setStartingPosition();
+	MoveLog log;
+	uint8_t result;
+	while ((result = board.playRandomMove(rng)) == Board::ONGOING) {
+		log.add(board.lastMove());
 	}
-}; // struct Coordinates
-
-class Board {
-	public:
-		Board(bool recordMoves = false);
-		void setStartingPosition();
-		std::vector<Coordinates> getAttacks(Coordinates piece);
-		bool attacks(Coordinates piece, Coordinates target);
-		bool isInCheck(bool side);
-		std::vector<Coordinates> getLegalMoves(Coordinates piece);
-		bool getSide(Coordinates coords);
-		void play(Coordinates piece, Coordinates target);
-		bool playRandom(bool side);
-		void print();
-		void clearPosition();
-		void setPiece(Coordinates coords, uint8_t piece);
-		bool loadFromFEN(std::string fen);
-		std::string exportFEN();
-		void exportPGN(std::string outputFile);
-
-		static constexpr bool WHITE = false;
-		static constexpr bool BLACK = true;
-
-		static constexpr uint8_t EMPTY = 0;
-		static constexpr uint8_t WPAWN = 1;
-		static constexpr uint8_t WKNIGHT = 2;
-		static constexpr uint8_t WBISHOP = 3;
-		static constexpr uint8_t WROOK = 4;
-		static constexpr uint8_t WQUEEN = 5;
-		static constexpr uint8_t WKING = 6;
-		static constexpr uint8_t BPAWN = 7;
-		static constexpr uint8_t BKNIGHT = 8;
-		static constexpr uint8_t BBISHOP = 9;
-		static constexpr uint8_t BROOK = 10;
-		static constexpr uint8_t BQUEEN = 11;
-		static constexpr uint8_t BKING = 12;
-		static constexpr uint8_t KINGSIDECASTLE = 13;
-		static constexpr uint8_t QUEENSIDECASTLE = 14;
-		static constexpr char *pieces = " PNBRQKpnbrqk";
-	private:
-		Coordinates whiteKingPosition;
-		Coordinates blackKingPosition;
-		uint8_t board[8][8];
-		int8_t enPassantFlag;
-		bool whiteKingSideCastle, whiteQueenSideCastle, blackKingSideCastle, blackQueenSideCastle;
-		int moveCount;
-		uint8_t pliesForDraw;
-		bool toPlay;
-		bool recordEnable;
-		std::string pgn;
-}; // class Board
-
-Board::Board(bool recordMoves) {
-	this->clearPosition();
-	this->enPassantFlag = -1;
-	this->whiteKingSideCastle = true;
-	this->whiteQueenSideCastle = true;
-	this->blackKingSideCastle = true;
-	this->blackQueenSideCastle = true;
-	this->moveCount = 0;
-	this->pliesForDraw = 0;
-	this->toPlay = WHITE;
-	this->recordEnable = recordMoves;
-	if (recordMoves) this->pgn = "[Event \"Casual Game\"]\n[Site \"Earth\"]\n[Date \"????.??.??\"]\n[Round \"1\"]\n[White \"Bax's Horrible Engine\"]\n[Black \"Bax's Horrible Engine\"]\n[Result \"*\"]\n";
+	std::cout << Board::describeResult(result) << std::endl;
+	board.print();
+	if (!PgnWriter("game.pgn").writeGame(log, PgnTags())) std::cout << "Can't write game.pgn" << std::endl;
+	std::cout << board.exportFEN() << std::endl;
+	return 0;
 }
 
-void Board::setStartingPosition() {
-	this->clearPosition();
-	this->board[0][0] = WROOK;
-	this->board[1][0] = WKNIGHT;
-	this->board[2][0] = WBISHOP;
-	this->board[3][0] = WQUEEN;
-	this->board[4][0] = WKING;
-	this->board[5][0] = WBISHOP;
-	this->board[6][0] = WKNIGHT;
-	this->board[7][0] = WROOK;
-	this->whiteKingPosition = {4, 0};
-
-	this->board[0][7] = BROOK;
-	this->board[1][7] = BKNIGHT;
-	this->board[2][7] = BBISHOP;
-	this->board[3][7] = BQUEEN;
-	this->board[4][7] = BKING;
-	this->board[5][7] = BBISHOP;
-	this->board[6][7] = BKNIGHT;
-	this->board[7][7] = BROOK;
-	this->blackKingPosition = {4, 7};
-
-	for (int i = 0; i < 8; i++) {
-		this->board[i][1] = WPAWN;
-		this->board[i][6] = BPAWN;
+// chess selfplay <games> [threads] [seed] [pgn file, - for stdout] [tablebase directory] [book]
+static int selfPlay(int argc, char **argv) {
+	SelfPlayOptions options;
+	options.threads = std::thread::hardware_concurrency();
+	options.seed = time(NULL);
+	if (argc > 2) options.games = strtoull(argv[2], nullptr, 10);
+	if (argc > 3) options.threads = atoi(argv[3]);
+	if (argc > 4) options.seed = strtoull(argv[4], nullptr, 10);
+	if (argc > 5) options.pgnPath = argv[5];
+	if (argc > 6) options.tablebasePath = argv[6];
+	if (argc > 7) options.bookPath = argv[7];
+	std::cout << "Playing " << options.games << " games on " << options.threads << " thread(s), seed " << options.seed << std::endl;
+	SelfPlayStats stats;
+	if (!runSelfPlay(options, stats)) {
+		std::cout << "Can't write " << options.pgnPath << std::endl;
+		return 1;
 	}
+	stats.print();
+	return 0;
 }
 
-std::vector<Coordinates> Board::getAttacks(Coordinates piece) {
-	std::vector<Coordinates> attacking;
-	switch (this->board[piece.file][piece.rank]) {
-		case EMPTY:
-			break;
-		case WPAWN:
-			attacking.push_back({piece.file - 1, piece.rank + 1});
-			attacking.push_back({piece.file + 1, piece.rank + 1});
-			break;
-		case BPAWN:
-			attacking.push_back({piece.file - 1, piece.rank - 1});
-			attacking.push_back({piece.file + 1, piece.rank - 1});
-			break;
-		case WKNIGHT:
-		case BKNIGHT:
-			attacking.push_back({piece.file - 1, piece.rank - 2});
-			attacking.push_back({piece.file - 1, piece.rank + 2});
-			attacking.push_back({piece.file + 1, piece.rank - 2});
-			attacking.push_back({piece.file + 1, piece.rank + 2});
-			attacking.push_back({piece.file - 2, piece.rank - 1});
-			attacking.push_back({piece.file - 2, piece.rank + 1});
-			attacking.push_back({piece.file + 2, piece.rank - 1});
-			attacking.push_back({piece.file + 2, piece.rank + 1});
-			break;
-		case WBISHOP:
-		case BBISHOP:
-			for (int i = 1; i <= std::min(piece.file, piece.rank); i++) {
-				attacking.push_back({piece.file - i, piece.rank - i});
-				if (this->board[piece.file - i][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(uint8_t(7 - piece.file), piece.rank); i++) {
-				attacking.push_back({piece.file + i, piece.rank - i});
-				if (this->board[piece.file + i][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(piece.file, uint8_t(7 - piece.rank)); i++) {
-				attacking.push_back({piece.file - i, piece.rank + i});
-				if (this->board[piece.file - i][piece.rank + i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(uint8_t(7 - piece.file), uint8_t(7 - piece.rank)); i++) {
-				attacking.push_back({piece.file + i, piece.rank + i});
-				if (this->board[piece.file + i][piece.rank + i] != EMPTY) break;
-			}
-			break;
-		case WROOK:
-		case BROOK:
-			for (int i = 1; i <= piece.file; i++) {
-				attacking.push_back({piece.file - i, piece.rank});
-				if (this->board[piece.file - i][piece.rank] != EMPTY) break;
-			}
-			for (int i = 1; i <= 7 - piece.file; i++) {
-				attacking.push_back({piece.file + i, piece.rank});
-				if (this->board[piece.file + i][piece.rank] != EMPTY) break;
-			}
-			for (int i = 1; i <= piece.rank; i++) {
-				attacking.push_back({piece.file, piece.rank - i});
-				if (this->board[piece.file][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= 7 - piece.rank; i++) {
-				attacking.push_back({piece.file, piece.rank + i});
-				if (this->board[piece.file][piece.rank + i] != EMPTY) break;
-			}
-			break;
-		case WQUEEN:
-		case BQUEEN:
-			for (int i = 1; i <= std::min(piece.file, piece.rank); i++) {
-				attacking.push_back({piece.file - i, piece.rank - i});
-				if (this->board[piece.file - i][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(uint8_t(7 - piece.file), piece.rank); i++) {
-				attacking.push_back({piece.file + i, piece.rank - i});
-				if (this->board[piece.file + i][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(piece.file, uint8_t(7 - piece.rank)); i++) {
-				attacking.push_back({piece.file - i, piece.rank + i});
-				if (this->board[piece.file - i][piece.rank + i] != EMPTY) break;
-			}
-			for (int i = 1; i <= std::min(uint8_t(7 - piece.file), uint8_t(7 - piece.rank)); i++) {
-				attacking.push_back({piece.file + i, piece.rank + i});
-				if (this->board[piece.file + i][piece.rank + i] != EMPTY) break;
-			}
-
-			for (int i = 1; i <= piece.file; i++) {
-				attacking.push_back({piece.file - i, piece.rank});
-				if (this->board[piece.file - i][piece.rank] != EMPTY) break;
-			}
-			for (int i = 1; i <= 7 - piece.file; i++) {
-				attacking.push_back({piece.file + i, piece.rank});
-				if (this->board[piece.file + i][piece.rank] != EMPTY) break;
-			}
-			for (int i = 1; i <= piece.rank; i++) {
-				attacking.push_back({piece.file, piece.rank - i});
-				if (this->board[piece.file][piece.rank - i] != EMPTY) break;
-			}
-			for (int i = 1; i <= 7 - piece.rank; i++) {
-				attacking.push_back({piece.file, piece.rank + i});
-				if (this->board[piece.file][piece.rank + i] != EMPTY) break;
-			}
-			break;
-		case WKING:
-		case BKING:
-			attacking.push_back({piece.file, piece.rank + 1});
-			attacking.push_back({piece.file, piece.rank - 1});
-			attacking.push_back({piece.file - 1, piece.rank + 1});
-			attacking.push_back({piece.file - 1, piece.rank - 1});
-			attacking.push_back({piece.file + 1, piece.rank + 1});
-			attacking.push_back({piece.file + 1, piece.rank - 1});
-			attacking.push_back({piece.file - 1, piece.rank});
-			attacking.push_back({piece.file + 1, piece.rank});
+// chess search <depth> [fen]
+static int searchPosition(int argc, char **argv) {
+	Board board;
+	int depth = argc > 2 ? atoi(argv[2]) : 8;
+	std::string fen = "";
+	for (int i = 3; i < argc; i++) {
+		if (i > 3) fen += ' ';
+		fen += argv[i];
 	}
-	for (int i = 0; i < attacking.size(); i++) {
-		if (attacking[i].file > 7 || attacking[i].rank > 7) {
-			attacking.erase(attacking.begin() + i);
-			i--;
-		}
+	if (fen.empty()) {
+		board.setStartingPosition();
+	} else if (!board.loadFromFEN(fen)) {
+		std::cout << "Invalid FEN: " << fen << std::endl;
+		return 1;
 	}
-	return attacking;
-}
-
-bool Board::attacks(Coordinates piece, Coordinates target) {
-	std::vector<Coordinates> attacking = this->getAttacks(piece);
-	for (int i = 0; i < attacking.size(); i++) {
-		if (attacking[i] == target) {
-			return true;
+	TranspositionTable tt(64);
+	SearchLimits limits;
+	limits.depth = depth;
+	limits.onIteration = [](const SearchResult &result) {
+		std::cout << "depth " << result.depth << " score " << formatScore(result.score) << " nodes " << result.nodes
+			<< " nps " << result.nps << " ebf " << result.branchingFactor << " pv";
+		for (Move move : result.pv) {
+			std::cout << " " << Board::toUCI(move);
 		}
-	}
-	return false;
+		std::cout << std::endl;
+	};
+	SearchResult result = board.search(limits, tt);
+	std::cout << "bestmove " << Board::toUCI(result.bestMove) << " (" << formatScore(result.score) << ", "
+		<< result.nodes << " nodes in " << result.seconds << " s)" << std::endl;
+	return 0;
 }
 
-bool Board::isInCheck(bool side) {
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			if (this->board[i][j] != EMPTY && this->getSide({i, j}) != side) {
-				if (side == WHITE) {
-					if (this->attacks({i, j}, this->whiteKingPosition)) {
-						return true;
-					}
-				} else {
-					if (this->attacks({i, j}, this->blackKingPosition)) {
-						return true;
-					}
-				}
-			}
-		}
+// chess mcts <playouts> [threads] [memory MB] [fen]
+static int mctsSearch(int argc, char **argv) {
+	Board board;
+	MctsLimits limits;
+	limits.playouts = argc > 2 ? strtoull(argv[2], nullptr, 10) : 100000;
+	limits.threads = argc > 3 ? atoi(argv[3]) : 1;
+	size_t megabytes = argc > 4 ? strtoull(argv[4], nullptr, 10) : MctsTree::DEFAULTMB;
+	std::string fen = "";
+	for (int i = 5; i < argc; i++) {
+		if (i > 5) fen += ' ';
+		fen += argv[i];
 	}
-	return false;
-}
-
-std::vector<Coordinates> Board::getLegalMoves(Coordinates piece) {
-	std::vector<Coordinates> legalMoves = this->getAttacks(piece);
-	uint8_t currentStatus = this->board[piece.file][piece.rank];
-	uint8_t destinationStatus;
-	int8_t enPassant = -1;
-	bool side = this->getSide(piece);
-	if (currentStatus == WPAWN) {
-		for (int i = 0; i < legalMoves.size(); i++) {
-			if (this->board[legalMoves[i].file][legalMoves[i].rank] == EMPTY) {
-				if (legalMoves[i].file != this->enPassantFlag || legalMoves[i].rank != 5) {
-					legalMoves.erase(legalMoves.begin() + i);
-					i--;
-				} else {
-					enPassant = i;
-				}
-			} else {
-				if (this->getSide(legalMoves[i]) == WHITE) {
-					legalMoves.erase(legalMoves.begin() + i);
-					i--;
-				}
-			}
-		}
-		if (this->board[piece.file][piece.rank + 1] == EMPTY) {
-			legalMoves.push_back({piece.file, piece.rank + 1});
-			if (piece.rank == 1) {
-				if (this->board[piece.file][piece.rank + 2] == EMPTY) {
-					legalMoves.push_back({piece.file, piece.rank + 2});
-				}
-			}
-		}
-		for (int i = 0; i < legalMoves.size(); i++) {
-			if (legalMoves[i].rank == 7 && legalMoves[i].promotion == 0) {
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, WKNIGHT});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, WBISHOP});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, WROOK});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, WQUEEN});
-				legalMoves.erase(legalMoves.begin() + i);
-				i--;
-			}
-		}
-	} else if (currentStatus == BPAWN) {
-		for (int i = 0; i < legalMoves.size(); i++) {
-			if (this->board[legalMoves[i].file][legalMoves[i].rank] == EMPTY) {
-				if (legalMoves[i].file != this->enPassantFlag || legalMoves[i].rank != 2) {
-					legalMoves.erase(legalMoves.begin() + i);
-					i--;
-				} else {
-					enPassant = i;
-				}
-			} else {
-				if (this->getSide(legalMoves[i]) == BLACK) {
-					legalMoves.erase(legalMoves.begin() + i);
-					i--;
-				}
-			}
-		}
-		if (this->board[piece.file][piece.rank - 1] == EMPTY) {
-			legalMoves.push_back({piece.file, piece.rank - 1});
-			if (piece.rank == 6) {
-				if (this->board[piece.file][piece.rank - 2] == EMPTY) {
-					legalMoves.push_back({piece.file, piece.rank - 2});
-				}
-			}
-		}
-		for (int i = 0; i < legalMoves.size(); i++) {
-			if (legalMoves[i].rank == 0 && legalMoves[i].promotion == 0) {
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, BKNIGHT});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, BBISHOP});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, BROOK});
-				legalMoves.push_back({legalMoves[i].file, legalMoves[i].rank, BQUEEN});
-				legalMoves.erase(legalMoves.begin() + i);
-				i--;
-			}
-		}
-	} else if (currentStatus == WKING || currentStatus == BKING) {
-		if (side == WHITE ? this->whiteKingSideCastle : this->blackKingSideCastle) {
-			if (!this->isInCheck(side) && this->board[piece.file + 1][piece.rank] == EMPTY) {
-				(side == WHITE ? this->whiteKingPosition : this->blackKingPosition) = {piece.file + 1, piece.rank};
-				if (!this->isInCheck(side) && this->board[piece.file + 2][piece.rank] == EMPTY) {
-					(side == WHITE ? this->whiteKingPosition : this->blackKingPosition) = {piece.file + 2, piece.rank};
-					if (!this->isInCheck(side)) {
-						legalMoves.push_back({piece.file + 2, piece.rank, KINGSIDECASTLE});
-					}
-				}
-			}
-		}
-		if (side == WHITE ? this->whiteQueenSideCastle : this->blackQueenSideCastle) {
-			if (!this->isInCheck(side) && this->board[piece.file - 1][piece.rank] == EMPTY) {
-				(side == WHITE ? this->whiteKingPosition : this->blackKingPosition) = {piece.file - 1, piece.rank};
-				if (!this->isInCheck(side) && this->board[piece.file - 2][piece.rank] == EMPTY) {
-					(side == WHITE ? this->whiteKingPosition : this->blackKingPosition) = {piece.file - 2, piece.rank};
-					if (!this->isInCheck(side) && this->board[piece.file - 3][piece.rank] == EMPTY) {
-						legalMoves.push_back({piece.file - 2, piece.rank, QUEENSIDECASTLE});
-					}
-				}
-			}
-		}
-		(side == WHITE ? this->whiteKingPosition : this->blackKingPosition) = piece;
+	if (fen.empty()) {
+		board.setStartingPosition();
+	} else if (!board.loadFromFEN(fen)) {
+		std::cout << "Invalid FEN: " << fen << std::endl;
+		return 1;
 	}
-	this->board[piece.file][piece.rank] = EMPTY;
-	for (int i = 0; i < legalMoves.size(); i++) {
-		destinationStatus = this->board[legalMoves[i].file][legalMoves[i].rank];
-		if (destinationStatus != EMPTY && this->getSide(legalMoves[i]) == side) {
-			legalMoves.erase(legalMoves.begin() + i);
-			i--;
-			continue;
-		}
-		this->board[legalMoves[i].file][legalMoves[i].rank] = currentStatus;
-		if (legalMoves[i].promotion > 0 && legalMoves[i].promotion < KINGSIDECASTLE) {
-			this->board[legalMoves[i].file][legalMoves[i].rank] = legalMoves[i].promotion;
-		}
-		if (i == enPassant) {
-			if (side == WHITE) {
-				this->board[legalMoves[i].file][legalMoves[i].rank - 1] = EMPTY;
-			} else {
-				this->board[legalMoves[i].file][legalMoves[i].rank + 1] = EMPTY;
-			}
-		}
-		if (currentStatus == WKING) {
-			this->whiteKingPosition = legalMoves[i];
-		} else if (currentStatus == BKING) {
-			this->blackKingPosition = legalMoves[i];
+	auto print = [](const MctsResult &result) {
+		std::cout << "playouts " << result.playouts << " pps " << result.playoutsPerSecond << " score cp " << result.score
+			<< " nodes " << result.treeNodes << " (" << result.treeBytes / (1 << 20) << " MB" << (result.treeFull ? ", full" : "") << ") pv";
+		for (Move move : result.pv) {
+			std::cout << " " << Board::toUCI(move);
 		}
-		if (this->isInCheck(side)) {
-			if (i == enPassant) {
-				if (side == WHITE) {
-					this->board[legalMoves[i].file][legalMoves[i].rank - 1] = BPAWN;
-				} else {
-					this->board[legalMoves[i].file][legalMoves[i].rank + 1] = WPAWN;
-				}
-			}
-			this->board[legalMoves[i].file][legalMoves[i].rank] = destinationStatus;
-			legalMoves.erase(legalMoves.begin() + i);
-			i--;
-			continue;
-		}
-		if (i == enPassant) {
-			if (side == WHITE) {
-				this->board[legalMoves[i].file][legalMoves[i].rank - 1] = BPAWN;
-			} else {
-				this->board[legalMoves[i].file][legalMoves[i].rank + 1] = WPAWN;
-			}
-		}
-		this->board[legalMoves[i].file][legalMoves[i].rank] = destinationStatus;
-	}
-	this->board[piece.file][piece.rank] = currentStatus;
-	if (currentStatus == WKING) {
-		this->whiteKingPosition = piece;
-	} else if (currentStatus == BKING) {
-		this->blackKingPosition = piece;
-	}
-	return legalMoves;
-}
-
-bool Board::getSide(Coordinates coords) {
-	return (this->board[coords.file][coords.rank] > WKING);
+		std::cout << std::endl;
+	};
+	limits.onProgress = print;
+	MctsTree tree(megabytes);
+	MctsResult result = tree.search(board, limits);
+	print(result);
+	std::cout << "bestmove " << Board::toUCI(result.bestMove) << " (" << std::fixed << std::setprecision(1) << 100 * result.winRate
+		<< "%, " << result.playouts << " playouts in " << std::setprecision(3) << result.seconds << " s)" << std::endl;
+	return 0;
 }
 
-void Board::play(Coordinates piece, Coordinates target) {
-	if (this->recordEnable && this->moveCount % 2 == 0) {
-		this->pgn += std::to_string(this->moveCount / 2 + 1);
-		this->pgn += ". ";
-	}
-	bool isEnPassant = false;
-	if (target.file == this->enPassantFlag) {
-		if (this->getSide(piece) == WHITE && target.rank == 5) {
-			this->board[target.file][target.rank - 1] = EMPTY;
-			isEnPassant = true;
-		} else if (this->getSide(piece) == BLACK && target.rank == 2) {
-			this->board[target.file][target.rank + 1] = EMPTY;
-			isEnPassant = true;
-		}
-	}
-	if (this->board[piece.file][piece.rank] == WKING) {
-		this->whiteKingPosition = target;
-		this->whiteKingSideCastle = false;
-		this->whiteQueenSideCastle = false;
-	} else if (this->board[piece.file][piece.rank] == BKING) {
-		this->blackKingPosition = target;
-		this->blackKingSideCastle = false;
-		this->blackQueenSideCastle = false;
-	} else if (this->board[piece.file][piece.rank] == WROOK) {
-		if (piece.file == 0) this->whiteQueenSideCastle = false;
-		else if (piece.file == 7) this->whiteKingSideCastle = false;
-	} else if (this->board[piece.file][piece.rank] == BROOK) {
-		if (piece.file == 0) this->blackQueenSideCastle = false;
-		else if (piece.file == 7) this->blackKingSideCastle = false;
-	}
-	if (target.promotion == KINGSIDECASTLE) {
-		this->board[target.file][target.rank] = this->board[piece.file][piece.rank];
-		this->board[target.file - 1][target.rank] = this->board[7][target.rank];
-		this->board[7][target.rank] = EMPTY;
-		this->pliesForDraw++;
-		this->pgn += "O-O ";
-	} else if (target.promotion == QUEENSIDECASTLE) {
-		this->board[target.file][target.rank] = this->board[piece.file][piece.rank];
-		this->board[target.file + 1][target.rank] = this->board[0][target.rank];
-		this->board[0][target.rank] = EMPTY;
-		this->pliesForDraw++;
-		this->pgn += "O-O-O ";
-	} else if (target.promotion != 0) {
-		if (this->recordEnable) {
-			this->pgn += (char)(piece.file + 'a');
-			if (piece.file != target.file) {
-				this->pgn += 'x';
-				this->pgn += (char)(target.file + 'a');
-			}
-			this->pgn += std::to_string(target.rank + 1);
-			this->pgn += '=';
-			this->pgn += this->pieces[target.promotion % 6];
-		}
-		this->board[target.file][target.rank] = target.promotion;
-		this->pliesForDraw = 0;
-	} else {
-		if (this->recordEnable) {
-			if (this->board[piece.file][piece.rank] == WPAWN || this->board[piece.file][piece.rank] == BPAWN) {
-				this->pgn += (char)(piece.file + 'a');
-				if (piece.file != target.file) {
-					this->pgn += 'x';
-					this->pgn += (char)(target.file + 'a');
-				}
-			} else {
-				this->pgn += this->pieces[this->board[piece.file][piece.rank] % 6];
-				if (this->board[target.file][target.rank] != EMPTY) this->pgn += 'x';
-				this->pgn += (char)(target.file + 'a');
-				// check if any other piece with the same name attacks the same square
-			}
-			this->pgn += std::to_string(target.rank + 1);
-		}
-		if (this->board[piece.file][piece.rank] == WPAWN || this->board[piece.file][piece.rank] == BPAWN || this->board[target.file][target.rank] != EMPTY) {
-			this->pliesForDraw = 0;
-		} else {
-			this->pliesForDraw++;
-		}
-		this->board[target.file][target.rank] = this->board[piece.file][piece.rank];
-	}
-	if (this->recordEnable) this->pgn += ' ';
-
-	this->board[piece.file][piece.rank] = EMPTY;
-	this->enPassantFlag = -1;
-	if (this->board[target.file][target.rank] == WPAWN || this->board[target.file][target.rank] == BPAWN) {
-		if (abs(target.rank - piece.rank) == 2) {
-			this->enPassantFlag = target.file;
+// chess smp <depth> [max threads]
+// Time to reach a fixed depth on a few positions at 1, 2, 4, ... threads.
+static int smpScaling(int argc, char **argv) {
+	static const char *positions[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	};
+	int depth = argc > 2 ? atoi(argv[2]) : 8;
+	int maxThreads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+	if (maxThreads < 1) maxThreads = 1;
+	TranspositionTable tt(256);
+	double baseSeconds = 0;
+	std::cout << "threads   time (s)       nodes         nps  speedup" << std::endl;
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+		double seconds = 0;
+		uint64_t nodes = 0;
+		for (const char *fen : positions) {
+			Board board;
+			board.loadFromFEN(fen);
+			tt.clear();
+			SearchLimits limits;
+			limits.depth = depth;
+			limits.threads = threads;
+			SearchResult result = board.search(limits, tt);
+			seconds += result.seconds;
+			nodes += result.nodes;
 		}
+		if (threads == 1) baseSeconds = seconds;
+		std::cout << std::setw(7) << threads << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+			<< std::setw(12) << nodes << std::setw(12) << (uint64_t)(nodes / (seconds > 0 ? seconds : 1e-9))
+			<< std::setw(9) << std::setprecision(2) << baseSeconds / (seconds > 0 ? seconds : 1e-9) << std::endl;
+		if (threads < maxThreads && threads * 2 > maxThreads) threads = maxThreads / 2;
 	}
-	this->moveCount++;
-	this->toPlay = !this->toPlay;
+	return 0;
 }
 
-bool Board::playRandom(bool side) {
-	std::vector<std::pair<Coordinates, Coordinates>> allMoves;
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			if (this->board[i][j] != EMPTY && this->getSide({i, j}) == side) {
-				std::vector<Coordinates> legalMoves = this->getLegalMoves({i, j});
-				for (int k = 0; k < legalMoves.size(); k++) {
-					allMoves.push_back(std::make_pair(Coordinates(i, j), legalMoves[k]));
-				}
-			}
-		}
-	}
-	if (allMoves.size() == 0) {
-		if (this->isInCheck(side)) {
-			std::cout << "Checkmate. " << (side == WHITE ? "White " : "Black ") << "wins." << std::endl;
-			return false;
-		} else {
-			std::cout << "Stalemate. Draw." << std::endl;
-			return false;
-		}
+// chess epd <file> [threads]
+// Loads every position of an EPD or FEN file and counts their legal moves.
+static int loadEPD(int argc, char **argv) {
+	if (argc < 3) {
+		std::cout << "Usage: chess epd <file> [threads]" << std::endl;
+		return 1;
 	}
-	if (this->pliesForDraw == 150) {
-		std::cout << "75 moves since last pawn move or capture. Draw." << std::endl;
-		return false;
+	int threads = argc > 3 ? atoi(argv[3]) : std::thread::hardware_concurrency();
+	std::atomic<uint64_t> moves(0);
+	EpdStats stats;
+	bool loaded = loadPositions(argv[2], threads, [&moves](Board &board, std::string_view line, int thread) {
+		MoveList list;
+		board.getLegalMoves(list);
+		moves.fetch_add(list.size(), std::memory_order_relaxed);
+	}, stats);
+	if (!loaded) {
+		std::cout << "Can't open " << argv[2] << std::endl;
+		return 1;
 	}
-	int move = rand() % allMoves.size();
-	this->play(allMoves[move].first, allMoves[move].second);
-	return true;
+	double seconds = stats.seconds > 0 ? stats.seconds : 1e-9;
+	std::cout << "Positions: " << stats.positions << " (" << stats.invalid << " invalid)" << std::endl;
+	std::cout << "Legal moves: " << moves.load() << std::endl;
+	std::cout << "Time: " << std::fixed << std::setprecision(3) << stats.seconds << " s" << std::endl;
+	std::cout << "Positions/s: " << std::setprecision(0) << stats.positions / seconds << std::endl;
+	std::cout << "MB/s: " << std::setprecision(1) << stats.bytes / seconds / (1 << 20) << std::endl;
+	return 0;
 }
 
-void Board::clearPosition() {
-	for (int i = 0; i < 8; i++) {
-		for (int j = 0; j < 8; j++) {
-			this->board[i][j] = EMPTY;
-		}
+// chess pack <epd file> <output> [threads]
+static int packPositions(int argc, char **argv) {
+	if (argc < 4) {
+		std::cout << "Usage: chess pack <epd file> <output> [threads]" << std::endl;
+		return 1;
 	}
-}
-
-void Board::print() {
-	std::cout << "Turn " << (this->moveCount / 2) + 1 << " (" << (this->toPlay == WHITE ? "white" : "black") << " to move); " << (int)this->pliesForDraw << " plies since last capture or pawn move." << std::endl;
-	std::cout << "a b c d e f g h" << std::endl << std::endl;
-	for (int i = 7; i >= 0; i--) {
-		for (int j = 0; j < 8; j++) {
-			std::cout << this->pieces[this->board[j][i]] << " ";
-		}
-		std::cout << " " << i + 1 << std::endl;
+	int threads = argc > 4 ? atoi(argv[4]) : std::thread::hardware_concurrency();
+	PackedWriter writer(argv[3]);
+	if (!writer.isOpen()) {
+		std::cout << "Can't write " << argv[3] << std::endl;
+		return 1;
 	}
-	std::cout << "------------------" << std::endl;
-}
-
-void Board::setPiece(Coordinates coords, uint8_t piece) {
-	this->board[coords.file][coords.rank] = piece;
+	EpdStats stats;
+	bool loaded = loadPositions(argv[2], threads, [&writer](Board &board, std::string_view line, int thread) {
+		writer.write(board.pack());
+	}, stats);
+	if (!loaded) {
+		std::cout << "Can't open " << argv[2] << std::endl;
+		return 1;
+	}
+	writer.flush();
+	std::cout << "Packed " << writer.getCount() << " positions (" << stats.invalid << " invalid) in "
+		<< std::fixed << std::setprecision(3) << stats.seconds << " s" << std::endl;
+	return 0;
 }
 
-bool Board::loadFromFEN(std::string fen) {
-	std::istringstream iss(fen);
-	std::vector<std::string> results((std::istream_iterator<std::string>(iss)), std::istream_iterator<std::string>());
-	if (results.size() != 6) return false;
-	uint8_t rank = 7;
-	uint8_t file = 0;
-	for (int i = 0; i < results[0].size(); i++) {
-		switch (results[0][i]) {
-			case 'P':
-				this->board[file][rank] = WPAWN;
-				file++;
-				break;
-			case 'N':
-				this->board[file][rank] = WKNIGHT;
-				file++;
-				break;
-			case 'B':
-				this->board[file][rank] = WBISHOP;
-				file++;
-				break;
-			case 'R':
-				this->board[file][rank] = WROOK;
-				file++;
-				break;
-			case 'Q':
-				this->board[file][rank] = WQUEEN;
-				file++;
-				break;
-			case 'K':
-				this->board[file][rank] = WKING;
-				this->whiteKingPosition = {file, rank};
-				file++;
-				break;
-			case 'p':
-				this->board[file][rank] = BPAWN;
-				file++;
-				break;
-			case 'n':
-				this->board[file][rank] = BKNIGHT;
-				file++;
-				break;
-			case 'b':
-				this->board[file][rank] = BBISHOP;
-				file++;
-				break;
-			case 'r':
-				this->board[file][rank] = BROOK;
-				file++;
-				break;
-			case 'q':
-				this->board[file][rank] = BQUEEN;
-				file++;
-				break;
-			case 'k':
-				this->board[file][rank] = BKING;
-				this->blackKingPosition = {file, rank};
-				file++;
-				break;
-			case '/':
-				file = 0;
-				rank--;
-				break;
-			default:
-				uint8_t spaces = results[0][i] - '0';
-				if (file + spaces > 8) {
-					return false;
-				}
-				file += (int)spaces;
-				break;
-		}
+// chess unpack <file> [first] [count]
+static int unpackPositions(int argc, char **argv) {
+	if (argc < 3) {
+		std::cout << "Usage: chess unpack <file> [first] [count]" << std::endl;
+		return 1;
 	}
-	if (results[1][0] == 'b') {
-		this->toPlay = BLACK;
-	} else {
-		this->toPlay = WHITE;
+	PackedReader reader;
+	if (!reader.open(argv[2])) {
+		std::cout << "Can't open " << argv[2] << std::endl;
+		return 1;
 	}
-	this->whiteKingSideCastle = false;
-	this->whiteQueenSideCastle = false;
-	this->blackKingSideCastle = false;
-	this->blackQueenSideCastle = false;
-	for (int i = 0; i < results[2].size(); i++) {
-		switch (results[2][i]) {
-			case '-':
-				break;
-			case 'K':
-				this->whiteKingSideCastle = true;
-				break;
-			case 'Q':
-				this->whiteQueenSideCastle = true;
-				break;
-			case 'k':
-				this->blackKingSideCastle = true;
-				break;
-			case 'q':
-				this->blackQueenSideCastle = true;
-			default:
-				return false;
-		}
-	}
-	if (results[3][0] != '-') {
-		this->enPassantFlag = results[3][0] - 'a';
+	size_t first = argc > 3 ? strtoull(argv[3], nullptr, 10) : 0;
+	size_t count = argc > 4 ? strtoull(argv[4], nullptr, 10) : reader.size();
+	Board board;
+	for (size_t i = first; i < reader.size() && i - first < count; i++) {
+		if (board.unpack(reader[i])) std::cout << board.exportFEN() << std::endl;
+		else std::cout << "invalid position " << i << std::endl;
 	}
-	std::istringstream(results[4]) >> this->pliesForDraw;
-	std::istringstream(results[5]) >> this->moveCount;
-	this->moveCount *= 2;
-	return true;
+	return 0;
 }
 
-std::string Board::exportFEN() {
-	std::string fen = "";
-	for (int i = 7; i >= 0; i--) {
-		int emptySquareCount = 0;
-		for (int j = 0; j < 8; j++) {
-			if (this->board[j][i] == EMPTY) {
-				emptySquareCount++;
-			} else {
-				if (emptySquareCount > 0) {
-					fen += std::to_string(emptySquareCount);
-					emptySquareCount = 0;
-				}
-				fen += this->pieces[this->board[j][i]];
-			}
-		}
-		if (emptySquareCount > 0) {
-			fen += std::to_string(emptySquareCount);
+// chess evalcheck [games] [seed]
+// Plays random games and compares the incrementally updated evaluation with a
+// full recount after every legal move and every take back along the way.
+static int evalCheck(int argc, char **argv) {
+	uint64_t games = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000;
+	uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : time(NULL);
+	Rng rng(seed);
+	Board board;
+	uint64_t checks = 0, mismatches = 0;
+	auto check = [&]() {
+		checks++;
+		if (board.evaluate() == board.evaluateFromScratch()) return;
+		if (mismatches++ < 10) {
+			std::cout << "Mismatch: " << board.evaluate() << " != " << board.evaluateFromScratch() << " in " << board.exportFEN() << std::endl;
 		}
-		fen += '/';
-	}
-	fen.pop_back();
-	fen += (this->toPlay == WHITE ? " w " : " b ");
-	if (this->whiteKingSideCastle) fen += 'K';
-	if (this->whiteQueenSideCastle) fen += 'Q';
-	if (this->blackKingSideCastle) fen += 'k';
-	if (this->blackQueenSideCastle) fen += 'q';
-	if (fen.back() == ' ') fen += '-';
-	
-	fen += ' ';
-	if (this->enPassantFlag != -1) {
-		fen += (this->enPassantFlag + 'a');
-		fen += (this->toPlay == WHITE ? "6 " : "3 ");
-	} else {
-		fen += "- ";
+	};
+	for (uint64_t game = 0; game < games; game++) {
+		board.setStartingPosition();
+		do {
+			MoveList moves;
+			board.getLegalMoves(moves);
+			for (Move move : moves) {
+				board.play(move);
+				check();
+				board.unplay();
+				check();
+			}
+		} while (board.playRandomMove(rng) == Board::ONGOING);
 	}
-	fen += std::to_string((int)pliesForDraw);
-	fen += ' ';
-	fen += std::to_string(moveCount / 2 + 1);
-	return fen;
+	std::cout << checks << " checks, " << mismatches << " mismatches" << std::endl;
+	return mismatches ? 1 : 0;
 }
 
-void Board::exportPGN(std::string outputFile) {
-	if (!this->recordEnable) return;
-	std::ofstream out(outputFile + ".pgn");
-	out << this->pgn << std::endl;
-	out.close();
+// chess uci, then speak UCI on stdin/stdout
+static int uci() {
+	UciEngine engine;
+	engine.loop(std::cin);
+	return 0;
 }
 
-int main() {
-	srand(time(NULL));
-	Board board(true);
-	board.setStartingPosition();
-	bool toPlay = Board::WHITE;
-	while (true) {
-		if (!board.playRandom(toPlay)) break;
-		toPlay = !toPlay;
-	}
-	board.print();
-	board.exportPGN("game");
-	std::cout << board.exportFEN() << std::endl;
-	return 0;
-}
\ No newline at end of file
+int main(int argc, char **argv) {
+	std::string mode = argc > 1 ? argv[1] : "";
+	if (mode == "selfplay") return selfPlay(argc, argv);
+	if (mode == "search") return searchPosition(argc, argv);
+	if (mode == "smp") return smpScaling(argc, argv);
+	if (mode == "mcts") return mctsSearch(argc, argv);
+	if (mode == "uci") return uci();
+	if (mode == "evalcheck") return evalCheck(argc, argv);
+	if (mode == "epd") return loadEPD(argc, argv);
+	if (mode == "pack") return packPositions(argc, argv);
+	if (mode == "unpack") return unpackPositions(argc, argv);
+	return playOneGame();
+}
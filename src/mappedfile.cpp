@@ -0,0 +1,93 @@
+#include "mappedfile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile() {
+	this->close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string &path) {
+	this->close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize)) {
+		CloseHandle(file);
+		return false;
+	}
+	this->fileHandle = file;
+	this->size = (size_t)fileSize.QuadPart;
+	this->opened = true;
+	if (this->size == 0) return true;
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		this->close();
+		return false;
+	}
+	this->mappingHandle = mapping;
+	this->data = (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (!this->data) {
+		this->close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close() {
+	if (this->data) UnmapViewOfFile(this->data);
+	if (this->mappingHandle) CloseHandle(this->mappingHandle);
+	if (this->fileHandle) CloseHandle(this->fileHandle);
+	this->data = nullptr;
+	this->mappingHandle = nullptr;
+	this->fileHandle = nullptr;
+	this->size = 0;
+	this->opened = false;
+}
+
+#else
+
+bool MappedFile::open(const std::string &path) {
+	this->close();
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) return false;
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+	this->size = info.st_size;
+	this->opened = true;
+	if (this->size == 0) {
+		::close(fd);
+		return true;
+	}
+	void *mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// the mapping stays valid after the descriptor is gone
+	::close(fd);
+	if (mapped == MAP_FAILED) {
+		this->size = 0;
+		this->opened = false;
+		return false;
+	}
+	madvise(mapped, this->size, MADV_SEQUENTIAL);
+	this->data = (const char *)mapped;
+	return true;
+}
+
+void MappedFile::close() {
+	if (this->data) munmap((void *)this->data, this->size);
+	this->data = nullptr;
+	this->size = 0;
+	this->opened = false;
+}
+
+#endif
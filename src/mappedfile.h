@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// A read-only view of a whole file, mapped into memory instead of read. Works
+// with mmap on POSIX systems and with file mappings on Windows.
+class MappedFile {
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile &) = delete;
+		MappedFile &operator=(const MappedFile &) = delete;
+		~MappedFile();
+		bool open(const std::string &path);
+		void close();
+		bool isOpen() const {
+			return this->opened;
+		}
+		std::string_view view() const {
+			return std::string_view(this->data, this->size);
+		}
+		size_t getSize() const {
+			return this->size;
+		}
+	private:
+		const char *data = nullptr;
+		size_t size = 0;
+		// an empty file can't be mapped, but opens fine
+		bool opened = false;
+#ifdef _WIN32
+		void *fileHandle = nullptr;
+		void *mappingHandle = nullptr;
+#endif
+}; // class MappedFile
+
+#endif
@@ -0,0 +1,248 @@
+#include "mcts.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+static constexpr uint32_t NONODE = UINT32_MAX;
+
+static void initNode(MctsNode &node, Move move) {
+	node.visits.store(0, std::memory_order_relaxed);
+	node.virtualLoss.store(0, std::memory_order_relaxed);
+	node.score.store(0, std::memory_order_relaxed);
+	node.firstChild = 0;
+	node.childCount = 0;
+	node.move = move;
+	node.result = Board::ONGOING;
+	node.state.store(MctsNode::LEAF, std::memory_order_relaxed);
+}
+
+MctsTree::MctsTree(size_t megabytes) {
+	this->resize(megabytes);
+}
+
+void MctsTree::resize(size_t megabytes) {
+	// the pool isn't touched before it's used, so the pages only get committed as the tree grows
+	this->capacity = std::min<size_t>(std::max<size_t>(megabytes, 1) * 1024 * 1024 / sizeof(MctsNode), NONODE - 1);
+	this->nodes.reset(new MctsNode[this->capacity]);
+	this->clear();
+}
+
+void MctsTree::clear() {
+	this->used = 0;
+	this->full = false;
+	this->root = this->allocate(1);
+	initNode(this->nodes[this->root], Move::none());
+	this->rootKey = 0;
+	this->rootPly = -1;
+}
+
+uint32_t MctsTree::allocate(int count) {
+	if (this->full.load(std::memory_order_relaxed)) return NONODE;
+	size_t first = this->used.fetch_add(count, std::memory_order_relaxed);
+	if (first + count > this->capacity) {
+		this->full = true;
+		return NONODE;
+	}
+	return first;
+}
+
+// Gives a leaf its children, or marks it terminal. Only one thread gets to do it,
+// the others see EXPANDING and carry on as if it were still a leaf.
+bool MctsTree::expand(uint32_t index, Board &board, Rng &rng) {
+	MctsNode &node = this->nodes[index];
+	uint8_t expected = MctsNode::LEAF;
+	if (!node.state.compare_exchange_strong(expected, MctsNode::EXPANDING, std::memory_order_acquire)) return false;
+	// Like negamax, the root is searched whenever it has a move: a repetition or the
+	// move counter only end the game below it.
+	uint8_t result = index == this->root ? Board::ONGOING : board.getResult();
+	MoveList moves;
+	if (result == Board::ONGOING) board.getLegalMoves(moves);
+	if (moves.size() == 0 && result == Board::ONGOING) result = board.getResult();
+	if (result != Board::ONGOING) {
+		node.result = result;
+		node.state.store(MctsNode::TERMINAL, std::memory_order_release);
+		return true;
+	}
+	uint32_t first = this->allocate(moves.size());
+	if (first == NONODE) {
+		node.state.store(MctsNode::LEAF, std::memory_order_release);
+		return false;
+	}
+	// unvisited children are tried in order, so shuffle them
+	for (int i = moves.size() - 1; i > 0; i--) {
+		std::swap(moves[i], moves[rng.below(i + 1)]);
+	}
+	for (int i = 0; i < moves.size(); i++) {
+		initNode(this->nodes[first + i], moves[i]);
+	}
+	node.firstChild = first;
+	node.childCount = moves.size();
+	node.state.store(MctsNode::EXPANDED, std::memory_order_release);
+	return true;
+}
+
+// UCT, with the threads already below a child counted as visits that were lost
+uint32_t MctsTree::select(uint32_t index) {
+	const MctsNode &parent = this->nodes[index];
+	double parentVisits = parent.visits.load(std::memory_order_relaxed) + parent.virtualLoss.load(std::memory_order_relaxed);
+	double logVisits = std::log(std::max(parentVisits, 1.0));
+	uint32_t best = parent.firstChild;
+	double bestValue = -1;
+	for (uint32_t i = parent.firstChild; i < parent.firstChild + parent.childCount; i++) {
+		const MctsNode &child = this->nodes[i];
+		double visits = child.visits.load(std::memory_order_relaxed) + child.virtualLoss.load(std::memory_order_relaxed);
+		if (visits == 0) return i;
+		double value = child.score.load(std::memory_order_relaxed) / (2 * visits) + EXPLORATION * std::sqrt(logVisits / visits);
+		if (value > bestValue) {
+			bestValue = value;
+			best = i;
+		}
+	}
+	return best;
+}
+
+void MctsTree::runThread(const Board &root, const MctsLimits &limits, int threadIndex) {
+	Board board;
+	Rng rng(threadIndex + 1);
+	std::vector<uint32_t> path;
+	bool rootSide = root.getSideToMove();
+	auto lastProgress = this->start;
+	// every playout starts from the root again, only the moves below it are dropped
+	board.copyPosition(root);
+	size_t rootPlies = root.getHistory().size();
+	while (!this->stopped.load(std::memory_order_relaxed)) {
+		board.rewind(root, rootPlies);
+		path.clear();
+		uint32_t index = this->root;
+		path.push_back(index);
+		this->nodes[index].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+		while (true) {
+			uint8_t state = this->nodes[index].state.load(std::memory_order_acquire);
+			if (state == MctsNode::LEAF && this->nodes[index].visits.load(std::memory_order_relaxed) >= EXPANDVISITS) {
+				if (!this->expand(index, board, rng)) break;
+				state = this->nodes[index].state.load(std::memory_order_acquire);
+			}
+			if (state != MctsNode::EXPANDED) break;
+			index = this->select(index);
+			board.play(this->nodes[index].move);
+			path.push_back(index);
+			this->nodes[index].virtualLoss.fetch_add(1, std::memory_order_relaxed);
+			// a fresh child gets its first playout before it may grow
+			if (this->nodes[index].visits.load(std::memory_order_relaxed) < EXPANDVISITS) break;
+		}
+		const MctsNode &leaf = this->nodes[index];
+		uint8_t result = leaf.state.load(std::memory_order_acquire) == MctsNode::TERMINAL ? leaf.result : board.playout(rng);
+
+		// the node at an odd depth was reached by a move of the side to move at the root
+		for (size_t depth = 0; depth < path.size(); depth++) {
+			MctsNode &node = this->nodes[path[depth]];
+			bool mover = depth % 2 == 1 ? rootSide : !rootSide;
+			uint64_t points = 1;
+			if (result == Board::WHITEWINS) points = mover == Board::WHITE ? 2 : 0;
+			else if (result == Board::BLACKWINS) points = mover == Board::BLACK ? 2 : 0;
+			node.score.fetch_add(points, std::memory_order_relaxed);
+			node.visits.fetch_add(1, std::memory_order_relaxed);
+			node.virtualLoss.fetch_sub(1, std::memory_order_relaxed);
+		}
+
+		uint64_t done = this->playouts.fetch_add(1, std::memory_order_relaxed) + 1;
+		if (limits.playouts > 0 && done >= limits.playouts) this->stopped = true;
+		if (limits.stop && limits.stop->load(std::memory_order_relaxed)) this->stopped = true;
+		if (threadIndex != 0) continue;
+		auto now = std::chrono::steady_clock::now();
+		if (limits.timeMs > 0 && std::chrono::duration_cast<std::chrono::milliseconds>(now - this->start).count() >= limits.timeMs) this->stopped = true;
+		if (limits.onProgress && std::chrono::duration_cast<std::chrono::milliseconds>(now - lastProgress).count() >= PROGRESSMS) {
+			lastProgress = now;
+			limits.onProgress(this->collect());
+		}
+	}
+}
+
+// Follows the moves played since the last search down the tree.
+bool MctsTree::findRoot(const Board &board) {
+	if (this->rootPly < 0 || this->used.load() > this->capacity * REUSELIMIT) return false;
+	const std::vector<UndoInfo> &history = board.getHistory();
+	int ahead = board.getPly() - this->rootPly;
+	if (ahead < 0 || ahead > (int)history.size()) return false;
+	if ((ahead == 0 ? board.getKey() : history[history.size() - ahead].key) != this->rootKey) return false;
+	uint32_t index = this->root;
+	for (size_t i = history.size() - ahead; i < history.size(); i++) {
+		const MctsNode &node = this->nodes[index];
+		if (node.state.load(std::memory_order_acquire) != MctsNode::EXPANDED) return false;
+		uint32_t next = NONODE;
+		for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; child++) {
+			if (this->nodes[child].move == history[i].move) next = child;
+		}
+		if (next == NONODE) return false;
+		index = next;
+	}
+	this->root = index;
+	return true;
+}
+
+MctsResult MctsTree::collect() const {
+	MctsResult result;
+	result.treeNodes = std::min(this->used.load(std::memory_order_relaxed), this->capacity);
+	result.treeBytes = result.treeNodes * sizeof(MctsNode);
+	result.treeFull = this->full.load(std::memory_order_relaxed);
+	result.playouts = this->playouts.load(std::memory_order_relaxed);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+	result.playoutsPerSecond = result.seconds > 0 ? (uint64_t)(result.playouts / result.seconds) : 0;
+
+	uint32_t index = this->root;
+	while (this->nodes[index].state.load(std::memory_order_acquire) == MctsNode::EXPANDED) {
+		const MctsNode &node = this->nodes[index];
+		uint32_t best = NONODE, bestVisits = 0;
+		for (uint32_t child = node.firstChild; child < node.firstChild + node.childCount; child++) {
+			uint32_t visits = this->nodes[child].visits.load(std::memory_order_relaxed);
+			if (visits > bestVisits) {
+				bestVisits = visits;
+				best = child;
+			}
+		}
+		if (best == NONODE) break;
+		if (result.pv.empty()) {
+			result.bestMove = this->nodes[best].move;
+			result.winRate = this->nodes[best].score.load(std::memory_order_relaxed) / (2.0 * bestVisits);
+		}
+		result.pv.push_back(this->nodes[best].move);
+		index = best;
+	}
+	// stopped before the first playout, any legal move beats none
+	const MctsNode &rootNode = this->nodes[this->root];
+	if (result.pv.empty() && rootNode.state.load(std::memory_order_acquire) == MctsNode::EXPANDED && rootNode.childCount > 0) {
+		result.bestMove = this->nodes[rootNode.firstChild].move;
+	}
+	// the usual logistic mapping between expected score and centipawns
+	double winRate = std::min(std::max(result.winRate, 0.001), 0.999);
+	result.score = (int)std::lround(-400 * std::log10(1 / winRate - 1));
+	return result;
+}
+
+MctsResult MctsTree::search(const Board &board, const MctsLimits &limits) {
+	this->start = std::chrono::steady_clock::now();
+	this->stopped = false;
+	this->playouts = 0;
+	if (!this->findRoot(board)) this->clear();
+	this->rootKey = board.getKey();
+	this->rootPly = board.getPly();
+
+	Board root;
+	root.copyPosition(board);
+	Rng rng(0);
+	// a reused subtree may come with a root that was a draw by repetition further down
+	if (this->nodes[this->root].state.load() == MctsNode::TERMINAL) this->nodes[this->root].state = MctsNode::LEAF;
+	if (this->nodes[this->root].state.load() == MctsNode::LEAF) this->expand(this->root, root, rng);
+	if (this->nodes[this->root].state.load() != MctsNode::EXPANDED) return this->collect();
+
+	std::vector<std::thread> pool;
+	for (int i = 1; i < limits.threads; i++) {
+		pool.emplace_back(&MctsTree::runThread, this, std::cref(root), std::cref(limits), i);
+	}
+	this->runThread(root, limits, 0);
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+	return this->collect();
+}
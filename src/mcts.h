@@ -0,0 +1,102 @@
+#ifndef MCTS_H
+#define MCTS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "board.h"
+
+// One position of the tree, reached by move. Children of a node lie next to each
+// other in the pool, so a node only needs the index of the first one. Everything
+// the threads update during the search is a relaxed atomic, no node is ever locked.
+struct MctsNode {
+	std::atomic<uint32_t> visits;
+	// threads currently below this node, counted as losses so the next thread looks elsewhere
+	std::atomic<uint32_t> virtualLoss;
+	// half points for the side that played move: 2 per win, 1 per draw
+	std::atomic<uint64_t> score;
+	uint32_t firstChild;
+	uint16_t childCount;
+	Move move;
+	std::atomic<uint8_t> state;
+	uint8_t result;
+
+	static constexpr uint8_t LEAF = 0;
+	static constexpr uint8_t EXPANDING = 1;
+	static constexpr uint8_t EXPANDED = 2;
+	// the game is over here, result says how
+	static constexpr uint8_t TERMINAL = 3;
+}; // struct MctsNode
+
+struct MctsResult {
+	Move bestMove = Move::none();
+	// expected score of the best move, 0 to 1, and the same as centipawns
+	double winRate = 0.5;
+	int score = 0;
+	uint64_t playouts = 0;
+	double seconds = 0;
+	uint64_t playoutsPerSecond = 0;
+	size_t treeNodes = 0;
+	size_t treeBytes = 0;
+	// the pool ran out and the tree stopped growing
+	bool treeFull = false;
+	// the most visited line
+	std::vector<Move> pv;
+}; // struct MctsResult
+
+struct MctsLimits {
+	uint64_t playouts = 0; // 0 means no limit
+	int64_t timeMs = 0;    // 0 means no limit
+	int threads = 1;
+	const std::atomic<bool> *stop = nullptr;
+	// called about once a second while searching
+	std::function<void(const MctsResult &)> onProgress;
+}; // struct MctsLimits
+
+// UCT search over random playouts. All threads grow the same tree; virtual loss
+// spreads them over different lines. Nodes come from one pool allocated up front
+// and handed out with an atomic counter. Once it's used up the tree stops growing
+// and the search carries on with playouts from the existing leaves. The tree is
+// kept between searches: when the next position follows from the last root by
+// moves the tree knows, the subtree below them becomes the new root.
+class MctsTree {
+	public:
+		explicit MctsTree(size_t megabytes = DEFAULTMB);
+		void resize(size_t megabytes);
+		void clear();
+		MctsResult search(const Board &board, const MctsLimits &limits);
+
+		static constexpr size_t DEFAULTMB = 256;
+		// the exploration constant in the UCT formula, about sqrt(2)
+		static constexpr double EXPLORATION = 1.4;
+		// a leaf gets its children once it has seen this many playouts
+		static constexpr uint32_t EXPANDVISITS = 1;
+		// subtrees are only reused while less than this share of the pool is taken
+		static constexpr double REUSELIMIT = 0.5;
+		static constexpr int64_t PROGRESSMS = 1000;
+	private:
+		bool findRoot(const Board &board);
+		uint32_t allocate(int count);
+		bool expand(uint32_t index, Board &board, Rng &rng);
+		uint32_t select(uint32_t index);
+		void runThread(const Board &root, const MctsLimits &limits, int threadIndex);
+		MctsResult collect() const;
+
+		std::unique_ptr<MctsNode[]> nodes;
+		size_t capacity;
+		std::atomic<size_t> used;
+		std::atomic<bool> full;
+		std::atomic<uint64_t> playouts;
+		std::atomic<bool> stopped;
+		uint32_t root;
+		// where the root is, to find it again in the next search
+		uint64_t rootKey;
+		int rootPly;
+		std::chrono::steady_clock::time_point start;
+}; // class MctsTree
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef MOVE_H
+#define MOVE_H
+
+#include <cstdint>
+
+// A move packed into 16 bits: from square (bits 0-5), to square (6-11),
+// move type (12-13) and promotion piece type minus knight (14-15).
+// Castling is encoded as the king's move, en passant by its target square.
+struct Move {
+	static constexpr uint8_t NORMAL = 0;
+	static constexpr uint8_t PROMOTION = 1;
+	static constexpr uint8_t ENPASSANT = 2;
+	static constexpr uint8_t CASTLING = 3;
+
+	uint16_t data;
+
+	Move() = default;
+	constexpr Move(uint8_t from, uint8_t to, uint8_t type = NORMAL, uint8_t promotion = 2)
+		: data(from | (to << 6) | (type << 12) | ((promotion - 2) << 14)) {}
+
+	uint8_t from() const {
+		return this->data & 63;
+	}
+	uint8_t to() const {
+		return (this->data >> 6) & 63;
+	}
+	uint8_t type() const {
+		return (this->data >> 12) & 3;
+	}
+	// piece type, Board::KNIGHT to Board::QUEEN, only meaningful for promotions
+	uint8_t promotion() const {
+		return (this->data >> 14) + 2;
+	}
+	bool operator==(Move other) const {
+		return this->data == other.data;
+	}
+	bool operator!=(Move other) const {
+		return this->data != other.data;
+	}
+
+	static constexpr Move none() {
+		return Move(0, 0);
+	}
+}; // struct Move
+
+// Fixed capacity list living on the stack, no position has more than 218 legal moves.
+struct MoveList {
+	static constexpr int CAPACITY = 256;
+
+	Move moves[CAPACITY];
+	int count = 0;
+
+	void add(Move move) {
+		this->moves[this->count++] = move;
+	}
+	int size() const {
+		return this->count;
+	}
+	void clear() {
+		this->count = 0;
+	}
+	Move &operator[](int i) {
+		return this->moves[i];
+	}
+	Move operator[](int i) const {
+		return this->moves[i];
+	}
+	Move *begin() {
+		return this->moves;
+	}
+	Move *end() {
+		return this->moves + this->count;
+	}
+	bool contains(Move move) const {
+		for (int i = 0; i < this->count; i++) {
+			if (this->moves[i] == move) return true;
+		}
+		return false;
+	}
+}; // struct MoveList
+
+#endif
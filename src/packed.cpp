@@ -0,0 +1,102 @@
+#include "packed.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace Bitboards;
+
+PackedPosition Board::pack(int16_t score, uint8_t result) const {
+	PackedPosition packed;
+	std::memset(&packed, 0, sizeof(packed));
+	packed.occupied = this->byType[ALLPIECES];
+	Bitboard occupied = packed.occupied;
+	for (int i = 0; occupied; i++) {
+		packed.pieces[i / 2] |= this->pieceOn(popLsb(occupied)) << (i % 2 * 4);
+	}
+	packed.flags = this->toPlay | (this->getCastlingRights() << 1);
+	packed.enPassant = this->enPassantFlag;
+	// the game is over at 150 either way
+	packed.halfMoves = std::min<int>(this->pliesForDraw, 150);
+	packed.result = result;
+	packed.fullMoves = this->moveCount / 2 + 1;
+	packed.score = score;
+	return packed;
+}
+
+bool Board::unpack(const PackedPosition &packed) {
+	this->clearPosition();
+	if (popCount(packed.occupied) > PackedPosition::MAXPIECES) return false;
+	Bitboard occupied = packed.occupied;
+	for (int i = 0; occupied; i++) {
+		uint8_t piece = (packed.pieces[i / 2] >> (i % 2 * 4)) & 15;
+		if (piece == EMPTY || piece > BKING) {
+			this->clearPosition();
+			return false;
+		}
+		this->putPiece(popLsb(occupied), piece);
+	}
+	this->toPlay = packed.flags & 1;
+	uint8_t rights = (packed.flags >> 1) & 15;
+	int8_t enPassantFile = packed.enPassant < 0 ? -1 : packed.enPassant;
+	// the same checks a FEN has to pass, move generation relies on them
+	if (popCount(this->getPieces(WHITE, KING)) != 1 || popCount(this->getPieces(BLACK, KING)) != 1
+		|| !this->isConsistent(rights, enPassantFile) || packed.halfMoves > 150) {
+		this->clearPosition();
+		return false;
+	}
+	// pack() only writes a file when a pawn can take
+	if (enPassantFile != -1) {
+		uint8_t target = (this->toPlay == WHITE ? 40 : 16) + enPassantFile;
+		if (!(pawnAttacks[!this->toPlay][target] & this->getPieces(this->toPlay, PAWN))) {
+			this->clearPosition();
+			return false;
+		}
+	}
+	this->setCastlingRights(rights);
+	this->enPassantFlag = enPassantFile;
+	this->pliesForDraw = packed.halfMoves;
+	this->moveCount = (packed.fullMoves > 0 ? packed.fullMoves - 1 : 0) * 2 + this->toPlay;
+	this->key = this->computeKey();
+	return true;
+}
+
+PackedWriter::PackedWriter(const std::string &path) : file(path, std::ios::binary) {
+	this->buffer.reserve(BUFFERED);
+	this->count = 0;
+}
+
+PackedWriter::~PackedWriter() {
+	this->flush();
+}
+
+bool PackedWriter::isOpen() const {
+	return this->file.good();
+}
+
+void PackedWriter::write(const PackedPosition &position) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->buffer.push_back(position);
+	this->count++;
+	if (this->buffer.size() >= BUFFERED) this->writeBuffer();
+}
+
+void PackedWriter::writeBuffer() {
+	this->file.write((const char *)this->buffer.data(), this->buffer.size() * sizeof(PackedPosition));
+	this->buffer.clear();
+}
+
+void PackedWriter::flush() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->writeBuffer();
+	this->file.flush();
+}
+
+// a torn last record (say from a writer that was killed) is ignored
+bool PackedReader::open(const std::string &path) {
+	this->positions = nullptr;
+	this->count = 0;
+	if (!this->file.open(path)) return false;
+	this->positions = (const PackedPosition *)this->file.view().data();
+	this->count = this->file.getSize() / sizeof(PackedPosition);
+	return true;
+}
@@ -0,0 +1,77 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "mappedfile.h"
+
+// A position in 32 bytes, for datasets too big for FEN. The occupied squares
+// are a bitboard, their pieces follow as 4-bit Board piece codes in square
+// order, low nibble first. Files hold these back to back in the byte order of
+// the machine (little endian everywhere we run), so they can be mapped and
+// indexed directly.
+struct PackedPosition {
+	uint64_t occupied;
+	uint8_t pieces[16];
+	uint8_t flags;        // bit 0 set when black is to move, bits 1-4 the castling rights
+	int8_t enPassant;     // the en passant file, -1 for none
+	uint8_t halfMoves;
+	uint8_t result;       // a Board game result, ONGOING when not known
+	uint16_t fullMoves;
+	int16_t score;        // centipawns for the side to move, 0 when not known
+
+	static constexpr int MAXPIECES = 32;
+}; // struct PackedPosition
+
+static_assert(sizeof(PackedPosition) == 32, "PackedPosition must stay 32 bytes");
+
+// Appends packed positions to a file through a large buffer. Several threads may share one.
+class PackedWriter {
+	public:
+		explicit PackedWriter(const std::string &path);
+		~PackedWriter();
+		bool isOpen() const;
+		void write(const PackedPosition &position);
+		void flush();
+		uint64_t getCount() const {
+			return this->count;
+		}
+
+		static constexpr size_t BUFFERED = 1 << 15;
+	private:
+		void writeBuffer();
+
+		std::ofstream file;
+		std::vector<PackedPosition> buffer;
+		std::mutex mutex;
+		uint64_t count;
+}; // class PackedWriter
+
+// Random access to a file of packed positions, straight from the mapping.
+class PackedReader {
+	public:
+		bool open(const std::string &path);
+		size_t size() const {
+			return this->count;
+		}
+		const PackedPosition &operator[](size_t index) const {
+			return this->positions[index];
+		}
+		const PackedPosition *begin() const {
+			return this->positions;
+		}
+		const PackedPosition *end() const {
+			return this->positions + this->count;
+		}
+	private:
+		MappedFile file;
+		const PackedPosition *positions = nullptr;
+		size_t count = 0;
+}; // class PackedReader
+
+#endif
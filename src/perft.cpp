@@ -0,0 +1,112 @@
+#include "perft.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "tt.h"
+
+uint64_t perft(Board &board, int depth) {
+	if (depth == 0) return 1;
+	MoveList moves;
+	board.getLegalMoves(moves);
+	if (depth == 1) return moves.size();
+	uint64_t nodes = 0;
+	for (int i = 0; i < moves.size(); i++) {
+		board.play(moves[i]);
+		nodes += perft(board, depth - 1);
+		board.unplay();
+	}
+	return nodes;
+}
+
+// the same position at another depth needs an entry of its own
+static uint64_t perftKey(const Board &board, int depth) {
+	return board.getKey() ^ (depth * 0x9E3779B97F4A7C15ULL);
+}
+
+static uint64_t perftHashed(Board &board, int depth, TranspositionTable &tt) {
+	if (depth < 2) return perft(board, depth);
+	uint64_t key = perftKey(board, depth);
+	TTHit hit;
+	if (tt.probe(key, hit) && hit.depth == depth) return hit.payload;
+	MoveList moves;
+	board.getLegalMoves(moves);
+	uint64_t nodes = 0;
+	for (int i = 0; i < moves.size(); i++) {
+		board.play(moves[i]);
+		nodes += perftHashed(board, depth - 1, tt);
+		board.unplay();
+	}
+	tt.store(key, depth, TranspositionTable::BOUND_EXACT, nodes);
+	return nodes;
+}
+
+// A subtree handed to a thread: the root move it belongs to and the reply below it, if any.
+struct PerftTask {
+	int root;
+	Move reply;
+}; // struct PerftTask
+
+std::vector<PerftDivide> perftDivide(Board &board, int depth, const PerftOptions &options) {
+	std::vector<PerftDivide> divide;
+	if (depth < 1) return divide;
+	MoveList moves;
+	board.getLegalMoves(moves);
+	std::vector<PerftTask> tasks;
+	for (int i = 0; i < moves.size(); i++) {
+		divide.push_back({Board::toUCI(moves[i]), 0});
+		if (depth < 3) {
+			tasks.push_back({i, Move::none()});
+			continue;
+		}
+		board.play(moves[i]);
+		MoveList replies;
+		board.getLegalMoves(replies);
+		for (Move reply : replies) {
+			tasks.push_back({i, reply});
+		}
+		board.unplay();
+	}
+
+	std::unique_ptr<TranspositionTable> tt;
+	if (options.hashMB > 0) tt.reset(new TranspositionTable(options.hashMB));
+	std::unique_ptr<std::atomic<uint64_t>[]> counts(new std::atomic<uint64_t>[moves.size()]);
+	for (int i = 0; i < moves.size(); i++) {
+		counts[i] = 0;
+	}
+	std::atomic<size_t> nextTask(0);
+	auto worker = [&]() {
+		Board local;
+		local.copyPosition(board);
+		while (true) {
+			size_t task = nextTask.fetch_add(1, std::memory_order_relaxed);
+			if (task >= tasks.size()) break;
+			const PerftTask &todo = tasks[task];
+			int below = depth - 1;
+			local.play(moves[todo.root]);
+			if (todo.reply != Move::none()) {
+				local.play(todo.reply);
+				below--;
+			}
+			uint64_t nodes = tt ? perftHashed(local, below, *tt) : perft(local, below);
+			if (todo.reply != Move::none()) local.unplay();
+			local.unplay();
+			counts[todo.root].fetch_add(nodes, std::memory_order_relaxed);
+		}
+	};
+
+	int threads = options.threads > 0 ? options.threads : 1;
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+	for (int i = 0; i < moves.size(); i++) {
+		divide[i].nodes = counts[i];
+	}
+	return divide;
+}
@@ -0,0 +1,30 @@
+#ifndef PERFT_H
+#define PERFT_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+class TranspositionTable;
+
+struct PerftDivide {
+	std::string move;
+	uint64_t nodes;
+}; // struct PerftDivide
+
+struct PerftOptions {
+	int threads = 1;
+	// megabytes of perft hash, 0 for none. With it transpositions are counted
+	// once, which is much faster but checks play() and unplay() less.
+	size_t hashMB = 0;
+}; // struct PerftOptions
+
+// Counts the leaf nodes of the legal move tree, depth plies below the current position.
+uint64_t perft(Board &board, int depth);
+// Same count, split per root move. The subtrees two plies down are shared out
+// between the threads, which take the next one whenever they finish one.
+std::vector<PerftDivide> perftDivide(Board &board, int depth, const PerftOptions &options = PerftOptions());
+
+#endif
@@ -0,0 +1,251 @@
+#include "pgn.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include "mappedfile.h"
+
+PgnWriter::PgnWriter(std::ostream &out) {
+	this->out = &out;
+	this->games = 0;
+	this->buffer.reserve(BUFFERSIZE + BUFFERSIZE / 4);
+}
+
+PgnWriter::PgnWriter(const std::string &path) : file(path, std::ios::binary) {
+	this->out = &this->file;
+	this->games = 0;
+	this->buffer.reserve(BUFFERSIZE + BUFFERSIZE / 4);
+}
+
+PgnWriter::~PgnWriter() {
+	this->flush();
+}
+
+bool PgnWriter::isOpen() const {
+	return this->out->good();
+}
+
+const char *PgnWriter::resultString(uint8_t result) {
+	switch (result) {
+		case Board::WHITEWINS:
+			return "1-0";
+		case Board::BLACKWINS:
+			return "0-1";
+		case Board::STALEMATE:
+		case Board::SEVENTYFIVEMOVES:
+		case Board::REPETITION:
+		case Board::TABLEBASEDRAW:
+		case Board::DRAW:
+		case Board::INSUFFICIENTMATERIAL:
+			return "1/2-1/2";
+		default:
+			return "*";
+	}
+}
+
+static void addTag(std::string &text, const char *name, const std::string &value) {
+	text += '[';
+	text += name;
+	text += " \"";
+	text += value;
+	text += "\"]\n";
+}
+
+bool PgnWriter::formatGame(const MoveLog &log, const PgnTags &tags, std::string &text) {
+	// reused between games so replaying doesn't allocate
+	thread_local Board board;
+	thread_local std::string moveText;
+	if (log.startFEN.empty()) {
+		board.setStartingPosition();
+	} else if (!board.loadFromFEN(log.startFEN)) {
+		return false;
+	}
+
+	moveText.clear();
+	size_t lineLength = 0;
+	auto addToken = [&lineLength](const std::string &token) {
+		if (lineLength > 0 && lineLength + 1 + token.size() > LINELENGTH) {
+			moveText += '\n';
+			lineLength = 0;
+		} else if (lineLength > 0) {
+			moveText += ' ';
+			lineLength++;
+		}
+		moveText += token;
+		lineLength += token.size();
+	};
+	for (int i = 0; i < log.size(); i++) {
+		std::string token = "";
+		if (board.getSideToMove() == Board::WHITE) {
+			token = std::to_string(board.getPly() / 2 + 1) + ". ";
+		} else if (i == 0) {
+			token = std::to_string(board.getPly() / 2 + 1) + "... ";
+		}
+		token += board.toSAN(log.moves[i]);
+		board.play(log.moves[i]);
+		addToken(token);
+	}
+	const char *result = resultString(log.result != Board::ONGOING ? log.result : board.getResult());
+	addToken(result);
+
+	addTag(text, "Event", tags.event);
+	addTag(text, "Site", tags.site);
+	addTag(text, "Date", tags.date);
+	addTag(text, "Round", tags.round);
+	addTag(text, "White", tags.white);
+	addTag(text, "Black", tags.black);
+	addTag(text, "Result", result);
+	if (!log.startFEN.empty()) {
+		addTag(text, "SetUp", "1");
+		addTag(text, "FEN", log.startFEN);
+	}
+	text += '\n';
+	text += moveText;
+	text += "\n\n";
+	return true;
+}
+
+bool PgnWriter::writeGame(const MoveLog &log, const PgnTags &tags) {
+	thread_local std::string text;
+	text.clear();
+	if (!formatGame(log, tags, text)) return false;
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->buffer += text;
+	this->games++;
+	if (this->buffer.size() >= BUFFERSIZE) {
+		this->out->write(this->buffer.data(), this->buffer.size());
+		this->buffer.clear();
+	}
+	return true;
+}
+
+void PgnWriter::flush() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	this->out->write(this->buffer.data(), this->buffer.size());
+	this->buffer.clear();
+	this->out->flush();
+}
+
+// Moves a view past a comment, a variation (with everything nested in it) or a tag.
+static void skipBlock(std::string_view text, size_t &position) {
+	char open = text[position];
+	if (open == ';' || open == '%') {
+		size_t end = text.find('\n', position);
+		position = end == std::string_view::npos ? text.size() : end + 1;
+		return;
+	}
+	if (open == '{') {
+		size_t end = text.find('}', position);
+		position = end == std::string_view::npos ? text.size() : end + 1;
+		return;
+	}
+	if (open == '[') {
+		bool quoted = false;
+		for (position++; position < text.size(); position++) {
+			if (text[position] == '\\' && quoted) position++;
+			else if (text[position] == '"') quoted = !quoted;
+			else if (text[position] == ']' && !quoted) break;
+		}
+		position++;
+		return;
+	}
+	int depth = 0;
+	for (; position < text.size(); position++) {
+		char c = text[position];
+		if (c == '{' || c == ';') {
+			skipBlock(text, position);
+			position--;
+		} else if (c == '(') {
+			depth++;
+		} else if (c == ')' && --depth == 0) {
+			break;
+		}
+	}
+	position++;
+}
+
+bool readGames(const std::string &path, const GameCallback &onGame, PgnStats &stats) {
+	auto start = std::chrono::steady_clock::now();
+	MappedFile file;
+	if (!file.open(path)) return false;
+	std::string_view text = file.view();
+	Board board;
+	MoveLog log;
+	// a game starts with its first tag or move and ends with its result
+	bool inGame = false, started = false, valid = true;
+
+	auto finishGame = [&](uint8_t result) {
+		if (inGame) {
+			if (valid) {
+				log.result = result;
+				stats.games++;
+				onGame(log);
+			} else {
+				stats.invalid++;
+			}
+		}
+		log.reset();
+		inGame = started = false;
+		valid = true;
+	};
+
+	size_t position = 0;
+	while (position < text.size()) {
+		char c = text[position];
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '.') {
+			position++;
+			continue;
+		}
+		if (c == '[') {
+			// tags after moves mean the last game had no result
+			if (started) finishGame(Board::ONGOING);
+			inGame = true;
+			size_t tagStart = position;
+			skipBlock(text, position);
+			std::string_view tag = text.substr(tagStart, position - tagStart);
+			if (tag.substr(0, 5) == "[FEN ") {
+				size_t first = tag.find('"'), last = tag.rfind('"');
+				if (first != last) log.startFEN = std::string(tag.substr(first + 1, last - first - 1));
+			}
+			continue;
+		}
+		if (c == '{' || c == ';' || c == '(' || (c == '%' && (position == 0 || text[position - 1] == '\n'))) {
+			skipBlock(text, position);
+			continue;
+		}
+		size_t tokenStart = position;
+		while (position < text.size() && !strchr(" \t\r\n{}()[];", text[position])) position++;
+		if (position == tokenStart) {
+			position++;
+			continue;
+		}
+		std::string_view token = text.substr(tokenStart, position - tokenStart);
+		if (token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*") {
+			finishGame(token == "1-0" ? Board::WHITEWINS : token == "0-1" ? Board::BLACKWINS : token == "*" ? Board::ONGOING : Board::DRAW);
+			continue;
+		}
+		if (token[0] == '$') continue;
+		// move numbers, maybe run together with the move as in 1.e4 (but 0-0 is castling)
+		size_t numbers = token.find_first_not_of("0123456789.");
+		if (numbers == std::string_view::npos) continue;
+		if (token.substr(0, numbers).find('.') != std::string_view::npos) token.remove_prefix(numbers);
+		if (!valid) continue;
+		if (!started) {
+			inGame = started = true;
+			if (log.startFEN.empty()) board.setStartingPosition();
+			else if (!board.loadFromFEN(log.startFEN)) valid = false;
+		}
+		Move move = valid ? board.fromSAN(token) : Move::none();
+		if (move == Move::none()) {
+			valid = false;
+			continue;
+		}
+		board.play(move);
+		log.add(move);
+	}
+	if (started) finishGame(Board::ONGOING);
+	stats.bytes = text.size();
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return true;
+}
@@ -0,0 +1,94 @@
+#ifndef PGN_H
+#define PGN_H
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "board.h"
+#include "move.h"
+
+// The moves of one game as they were played, two bytes a ply. Recording a move
+// is a push_back, everything else (SAN, the result) is worked out by replaying
+// the moves when the game gets written.
+struct MoveLog {
+	std::string startFEN; // empty for the standard starting position
+	std::vector<Move> moves;
+	// set when the game was stopped before it ended, e.g. by a tablebase
+	uint8_t result = Board::ONGOING;
+
+	void reset(const std::string &fen = "") {
+		this->startFEN = fen;
+		this->moves.clear();
+		this->result = Board::ONGOING;
+	}
+	void add(Move move) {
+		this->moves.push_back(move);
+	}
+	int size() const {
+		return this->moves.size();
+	}
+}; // struct MoveLog
+
+struct PgnTags {
+	std::string event = "Casual Game";
+	std::string site = "Earth";
+	std::string date = "????.??.??";
+	std::string round = "1";
+	std::string white = "Bax's Horrible Engine";
+	std::string black = "Bax's Horrible Engine";
+}; // struct PgnTags
+
+// Writes any number of games into one PGN file, or any stream such as std::cout.
+// Games are formatted by the calling thread and collected in a large buffer that
+// goes out in one write once it fills up, so several threads can share a writer.
+class PgnWriter {
+	public:
+		explicit PgnWriter(std::ostream &out);
+		explicit PgnWriter(const std::string &path);
+		~PgnWriter();
+		bool isOpen() const;
+		// false if the game can't be replayed from its start position, it isn't written then
+		bool writeGame(const MoveLog &log, const PgnTags &tags);
+		void flush();
+		uint64_t getGames() const {
+			return this->games;
+		}
+
+		static constexpr size_t BUFFERSIZE = 1 << 20;
+		// PGN lines should stay under 80 characters
+		static constexpr size_t LINELENGTH = 79;
+
+		// formats one game, the result tag comes from the final position. Fails
+		// without touching text when the start FEN doesn't load.
+		static bool formatGame(const MoveLog &log, const PgnTags &tags, std::string &text);
+		static const char *resultString(uint8_t result);
+	private:
+		std::ofstream file;
+		std::ostream *out;
+		std::string buffer;
+		std::mutex mutex;
+		uint64_t games;
+}; // class PgnWriter
+
+struct PgnStats {
+	uint64_t games = 0;
+	uint64_t invalid = 0;
+	uint64_t bytes = 0;
+	double seconds = 0;
+}; // struct PgnStats
+
+// Called once for every game, the result is ONGOING for games that end in *.
+typedef std::function<void(const MoveLog &log)> GameCallback;
+
+// Reads every game of a PGN file, mapped into memory so it may be far larger
+// than RAM. Comments, variations and NAGs are skipped, of the tags only FEN is
+// used. A game with a move that isn't legal is counted as invalid and dropped.
+bool readGames(const std::string &path, const GameCallback &onGame, PgnStats &stats);
+
+#endif
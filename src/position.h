@@ -0,0 +1,100 @@
+#ifndef POSITION_H
+#define POSITION_H
+
+#include <cstdint>
+#include <type_traits>
+
+#include "bitboard.h"
+
+// Everything move generation needs to know about a position and nothing else: no
+// history, no game record. It's trivially copyable and two cache lines, so it can
+// be handed to another thread or kept in large arrays and copied with memcpy. The
+// mailbox packs two squares a byte. Board adds the moves that led here and
+// everything that changes the position.
+class alignas(64) Position {
+	public:
+		uint8_t pieceOn(uint8_t square) const {
+			return (this->mailbox[square / 2] >> (square % 2 * 4)) & 15;
+		}
+		Bitboard getPieces(bool side, uint8_t type) const {
+			return this->byType[type] & this->byColor[side];
+		}
+		uint8_t kingSquare(bool side) const {
+			return Bitboards::lsb(this->getPieces(side, KING));
+		}
+		bool getSideToMove() const {
+			return this->toPlay;
+		}
+		uint64_t getKey() const {
+			return this->key;
+		}
+		uint8_t getCastlingRights() const {
+			return this->castlingRights;
+		}
+		uint16_t getPliesForDraw() const {
+			return this->pliesForDraw;
+		}
+		// -1 unless a pawn can be taken en passant right now
+		int8_t getEnPassantFile() const {
+			return this->enPassantFlag;
+		}
+		// half moves since the start of the game, counting the ones before a loaded FEN
+		int getPly() const {
+			return this->moveCount;
+		}
+
+		static constexpr bool WHITE = false;
+		static constexpr bool BLACK = true;
+
+		static constexpr uint8_t EMPTY = 0;
+		static constexpr uint8_t WPAWN = 1;
+		static constexpr uint8_t WKNIGHT = 2;
+		static constexpr uint8_t WBISHOP = 3;
+		static constexpr uint8_t WROOK = 4;
+		static constexpr uint8_t WQUEEN = 5;
+		static constexpr uint8_t WKING = 6;
+		static constexpr uint8_t BPAWN = 7;
+		static constexpr uint8_t BKNIGHT = 8;
+		static constexpr uint8_t BBISHOP = 9;
+		static constexpr uint8_t BROOK = 10;
+		static constexpr uint8_t BQUEEN = 11;
+		static constexpr uint8_t BKING = 12;
+		static constexpr const char *pieces = " PNBRQKpnbrqk";
+
+		// piece types, a piece of either color maps onto these with pieceType()
+		static constexpr uint8_t ALLPIECES = 0;
+		static constexpr uint8_t PAWN = 1;
+		static constexpr uint8_t KNIGHT = 2;
+		static constexpr uint8_t BISHOP = 3;
+		static constexpr uint8_t ROOK = 4;
+		static constexpr uint8_t QUEEN = 5;
+		static constexpr uint8_t KING = 6;
+
+		static constexpr uint8_t pieceType(uint8_t piece) {
+			return piece > WKING ? piece - WKING : piece;
+		}
+		static constexpr uint8_t makePiece(bool side, uint8_t type) {
+			return side == WHITE ? type : type + WKING;
+		}
+	protected:
+		Bitboard byType[7];
+		Bitboard byColor[2];
+		uint64_t key;
+		// the piece on every square, the even one in the low four bits
+		uint8_t mailbox[32];
+		int moveCount;
+		// running sums for evaluate(), from white's point of view
+		int16_t mgScore, egScore;
+		// wide enough that moves played past the 75-move rule can't wrap it around
+		uint16_t pliesForDraw;
+		uint8_t phase;
+		int8_t enPassantFlag;
+		// bit 0 white king side, bit 1 white queen side, bits 2 and 3 the same for black
+		uint8_t castlingRights;
+		bool toPlay;
+}; // class Position
+
+static_assert(std::is_trivially_copyable<Position>::value, "positions are copied with memcpy");
+static_assert(sizeof(Position) <= 128, "a position should fit in two cache lines");
+
+#endif
@@ -0,0 +1,102 @@
+#include "profile.h"
+
+#ifdef PROFILE
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+namespace Profile {
+	static const char *pointNames[POINTCOUNT] = {
+		"getAttacks", "attacks", "attackersTo", "isInCheck", "getLegalMoves", "generateLegalMoves",
+		"randomLegalMove", "play", "unplay", "playRandomMove", "getResult", "repetitionCount", "toSAN", "see",
+		"negamax", "quiescence", "tt probe", "tt store"
+	};
+	static const char *valueNames[VALUECOUNT] = {"legal moves", "rejections", "repetition window", "undo stack"};
+
+	// Outlives every thread's counters, and reports once they're all added in.
+	struct Totals {
+		std::mutex mutex;
+		Counters sum;
+		uint64_t start = ticks();
+
+		void add(const Counters &other);
+		void report(std::ostream &out, bool json);
+		~Totals();
+	}; // struct Totals
+
+	static Totals totals;
+	thread_local Counters counters;
+
+	Counters::~Counters() {
+		totals.add(*this);
+	}
+
+	void Totals::add(const Counters &other) {
+		// the sum's own destructor runs too, as the totals go away
+		if (&other == &this->sum) return;
+		std::lock_guard<std::mutex> lock(this->mutex);
+		for (int i = 0; i < POINTCOUNT; i++) {
+			this->sum.calls[i] += other.calls[i];
+			this->sum.ticks[i] += other.ticks[i];
+		}
+		for (int i = 0; i < VALUECOUNT; i++) {
+			this->sum.samples[i] += other.samples[i];
+			this->sum.sums[i] += other.sums[i];
+			if (other.maxima[i] > this->sum.maxima[i]) this->sum.maxima[i] = other.maxima[i];
+		}
+	}
+
+	void Totals::report(std::ostream &out, bool json) {
+		uint64_t elapsed = ticks() - this->start;
+#if defined(__x86_64__) || defined(__i386__)
+		const char *unit = "tsc";
+#else
+		const char *unit = "ns";
+#endif
+		const Counters &c = this->sum;
+		if (json) {
+			out << "{\"unit\": \"" << unit << "\", \"elapsed\": " << elapsed << ", \"points\": [";
+			bool first = true;
+			for (int i = 0; i < POINTCOUNT; i++) {
+				if (c.calls[i] == 0) continue;
+				out << (first ? "" : ", ") << "{\"name\": \"" << pointNames[i] << "\", \"calls\": " << c.calls[i] << ", \"ticks\": " << c.ticks[i] << "}";
+				first = false;
+			}
+			out << "], \"values\": [";
+			first = true;
+			for (int i = 0; i < VALUECOUNT; i++) {
+				if (c.samples[i] == 0) continue;
+				out << (first ? "" : ", ") << "{\"name\": \"" << valueNames[i] << "\", \"samples\": " << c.samples[i]
+					<< ", \"sum\": " << c.sums[i] << ", \"max\": " << c.maxima[i] << "}";
+				first = false;
+			}
+			out << "]}" << std::endl;
+			return;
+		}
+		out << std::endl << "Profile (" << unit << ", inclusive, " << elapsed << " elapsed)" << std::endl;
+		out << std::setw(20) << "function" << std::setw(14) << "calls" << std::setw(18) << unit << std::setw(10) << "per call" << std::setw(8) << "%" << std::endl;
+		for (int i = 0; i < POINTCOUNT; i++) {
+			if (c.calls[i] == 0) continue;
+			out << std::setw(20) << pointNames[i] << std::setw(14) << c.calls[i] << std::setw(18) << c.ticks[i]
+				<< std::setw(10) << std::fixed << std::setprecision(1) << (double)c.ticks[i] / c.calls[i]
+				<< std::setw(8) << 100.0 * c.ticks[i] / (elapsed ? elapsed : 1) << std::endl;
+		}
+		out << std::endl << std::setw(20) << "value" << std::setw(14) << "samples" << std::setw(18) << "sum" << std::setw(10) << "mean" << std::setw(8) << "max" << std::endl;
+		for (int i = 0; i < VALUECOUNT; i++) {
+			if (c.samples[i] == 0) continue;
+			out << std::setw(20) << valueNames[i] << std::setw(14) << c.samples[i] << std::setw(18) << c.sums[i]
+				<< std::setw(10) << std::setprecision(2) << (double)c.sums[i] / c.samples[i] << std::setw(8) << c.maxima[i] << std::endl;
+		}
+	}
+
+	// the main thread's thread_local counters are gone by now, static objects go last
+	Totals::~Totals() {
+		const char *format = std::getenv("CHESS_PROFILE");
+		this->report(std::cerr, format && std::strcmp(format, "json") == 0);
+	}
+} // namespace Profile
+
+#endif
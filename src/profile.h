@@ -0,0 +1,91 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+// Counters for the hot paths, only compiled in with -DPROFILE (make profile).
+// Without it the macros are empty and nothing is left of them in the build.
+//   PROFILE_SCOPE(PLAY)            counts a call and the time until the end of the block
+//   PROFILE_VALUE(LEGALMOVES, n)   adds a sample to a value's count, sum and maximum
+// Every thread counts into its own thread_local copy, which is added to the
+// totals when the thread ends. The report goes to stderr when the program exits,
+// as a table, or as JSON when the environment has CHESS_PROFILE=json.
+
+#ifdef PROFILE
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+namespace Profile {
+	// times are inclusive, a scope's time contains the scopes it calls
+	enum Point {
+		GETATTACKS, ATTACKS, ATTACKERSTO, ISINCHECK, GETLEGALMOVES, GENERATELEGALMOVES,
+		RANDOMLEGALMOVE, PLAY, UNPLAY, PLAYRANDOMMOVE, GETRESULT, REPETITIONCOUNT, TOSAN, SEE,
+		NEGAMAX, QUIESCENCE, TTPROBE, TTSTORE, POINTCOUNT
+	};
+	enum Value {
+		// moves per generateLegalMoves() call
+		LEGALMOVES,
+		// candidates randomLegalMove() drew and found illegal
+		REJECTIONS,
+		// plies repetitionCount() looked back over
+		REPETITIONWINDOW,
+		// the undo stack's length in play(), how deep games and searches go
+		UNDOSTACK,
+		VALUECOUNT
+	};
+
+	struct Counters {
+		uint64_t calls[POINTCOUNT] = {0};
+		uint64_t ticks[POINTCOUNT] = {0};
+		uint64_t samples[VALUECOUNT] = {0};
+		uint64_t sums[VALUECOUNT] = {0};
+		uint64_t maxima[VALUECOUNT] = {0};
+		// adds this thread's counts to the totals
+		~Counters();
+	}; // struct Counters
+
+	extern thread_local Counters counters;
+
+	// TSC ticks where there is a TSC, nanoseconds elsewhere
+	inline uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#else
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+	}
+
+	class Scope {
+		public:
+			explicit Scope(Point point) : point(point), start(ticks()) {}
+			~Scope() {
+				counters.calls[this->point]++;
+				counters.ticks[this->point] += ticks() - this->start;
+			}
+		private:
+			Point point;
+			uint64_t start;
+	}; // class Scope
+
+	inline void record(Value value, uint64_t sample) {
+		counters.samples[value]++;
+		counters.sums[value] += sample;
+		if (sample > counters.maxima[value]) counters.maxima[value] = sample;
+	}
+} // namespace Profile
+
+#define PROFILE_SCOPE(point) Profile::Scope profileScope(Profile::point)
+#define PROFILE_VALUE(value, sample) Profile::record(Profile::value, sample)
+
+#else
+
+#define PROFILE_SCOPE(point)
+#define PROFILE_VALUE(value, sample)
+
+#endif
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <cstdint>
+
+// xoshiro256**, small and fast enough to give every thread its own generator.
+// The same seed always produces the same sequence.
+class Rng {
+	public:
+		Rng(uint64_t seed = 0) {
+			this->seed(seed);
+		}
+
+		void seed(uint64_t seed) {
+			// expand the seed with splitmix64 so that close seeds give unrelated states
+			for (int i = 0; i < 4; i++) {
+				seed += 0x9E3779B97F4A7C15ULL;
+				uint64_t z = seed;
+				z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+				z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+				this->state[i] = z ^ (z >> 31);
+			}
+		}
+
+		uint64_t next() {
+			uint64_t result = rotl(this->state[1] * 5, 7) * 9;
+			uint64_t t = this->state[1] << 17;
+			this->state[2] ^= this->state[0];
+			this->state[3] ^= this->state[1];
+			this->state[1] ^= this->state[2];
+			this->state[0] ^= this->state[3];
+			this->state[2] ^= t;
+			this->state[3] = rotl(this->state[3], 45);
+			return result;
+		}
+
+		// uniform in [0, bound) without a division, the bias is far below anything we can measure
+		uint32_t below(uint32_t bound) {
+			return (uint32_t)(((this->next() >> 32) * bound) >> 32);
+		}
+	private:
+		static uint64_t rotl(uint64_t x, int k) {
+			return (x << k) | (x >> (64 - k));
+		}
+
+		uint64_t state[4];
+}; // class Rng
+
+#endif
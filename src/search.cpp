@@ -0,0 +1,383 @@
+#include "search.h"
+
+#include <cstring>
+#include <memory>
+#include <thread>
+
+#include "profile.h"
+#include "tablebase.h"
+
+SearchResult Board::search(const SearchLimits &limits, TranspositionTable &tt) {
+	SearchShared shared;
+	tt.newGeneration();
+	std::vector<std::unique_ptr<Board>> boards;
+	std::vector<std::unique_ptr<Searcher>> helpers;
+	std::vector<std::thread> pool;
+	for (int i = 1; i < limits.threads; i++) {
+		boards.emplace_back(new Board());
+		boards.back()->copyPosition(*this);
+		helpers.emplace_back(new Searcher(*boards.back(), tt, shared, i));
+		Searcher *helper = helpers.back().get();
+		pool.emplace_back([helper, &limits]() {
+			helper->run(limits);
+		});
+	}
+	Searcher searcher(*this, tt, shared, 0);
+	SearchResult result = searcher.run(limits);
+	shared.stop = true;
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+	result.nodes = shared.nodes.load();
+	result.nps = result.seconds > 0 ? (uint64_t)(result.nodes / result.seconds) : 0;
+	return result;
+}
+
+Searcher::Searcher(Board &board, TranspositionTable &tt, SearchShared &shared, int threadIndex)
+	: board(board), tt(tt), shared(shared), threadIndex(threadIndex), rng(threadIndex) {
+	this->nodes = 0;
+	this->flushedNodes = 0;
+	this->stopped = false;
+}
+
+std::string formatScore(int score) {
+	if (score > Searcher::MATEBOUND) return "mate " + std::to_string((Searcher::MATE - score + 1) / 2);
+	if (score < -Searcher::MATEBOUND) return "mate -" + std::to_string((Searcher::MATE + score) / 2);
+	return "cp " + std::to_string(score);
+}
+
+// mate scores are stored relative to the node, not the root, so they stay valid wherever the position is reached again
+static int scoreToTT(int score, int ply) {
+	if (score > Searcher::MATEBOUND) return score + ply;
+	if (score < -Searcher::MATEBOUND) return score - ply;
+	return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+	if (score > Searcher::MATEBOUND) return score - ply;
+	if (score < -Searcher::MATEBOUND) return score + ply;
+	return score;
+}
+
+// payload layout: move in bits 0-15, score in bits 16-31
+static uint64_t packEntry(Move move, int score) {
+	return move.data | ((uint64_t)(uint16_t)(int16_t)score << 16);
+}
+
+static Move entryMove(uint64_t payload) {
+	Move move;
+	move.data = payload & 0xFFFF;
+	return move;
+}
+
+static int entryScore(uint64_t payload) {
+	return (int16_t)(uint16_t)(payload >> 16);
+}
+
+SearchResult Searcher::run(const SearchLimits &limits) {
+	this->limits = limits;
+	this->start = std::chrono::steady_clock::now();
+	this->nodes = 0;
+	this->flushedNodes = 0;
+	this->stopped = false;
+	std::memset(this->killers, 0, sizeof(this->killers));
+	std::memset(this->history, 0, sizeof(this->history));
+	bool mainThread = this->threadIndex == 0;
+
+	SearchResult result;
+	MoveList rootMoves;
+	this->board.getLegalMoves(rootMoves);
+	if (rootMoves.size() == 0) {
+		result.score = this->board.isInCheck(this->board.getSideToMove()) ? -MATE : 0;
+		return result;
+	}
+
+	uint64_t previousIterationNodes = 0;
+	int maxDepth = limits.depth < MAXPLY - 1 ? limits.depth : MAXPLY - 1;
+	// odd helpers start one ply deeper, so the threads aren't all on the same iteration
+	int firstDepth = mainThread ? 1 : 1 + this->threadIndex % 2;
+	for (int depth = firstDepth; depth <= maxDepth; depth++) {
+		uint64_t iterationStart = this->nodes;
+		int score = this->negamax(depth, 0, -INFINITE, INFINITE);
+		if (this->stopped) break;
+
+		uint64_t iterationNodes = this->nodes - iterationStart;
+		result.bestMove = this->pv[0][0];
+		result.score = score;
+		result.depth = depth;
+		result.pv.assign(this->pv[0], this->pv[0] + this->pvLength[0]);
+		result.branchingFactor = previousIterationNodes ? (double)iterationNodes / previousIterationNodes : 0;
+		previousIterationNodes = iterationNodes;
+		this->flushNodes();
+		result.nodes = this->shared.nodes.load(std::memory_order_relaxed);
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+		result.nps = result.seconds > 0 ? (uint64_t)(result.nodes / result.seconds) : 0;
+		if (!mainThread) continue;
+		if (limits.onIteration) limits.onIteration(result);
+
+		// a found mate won't get any shorter by searching deeper
+		if (score > MATEBOUND || score < -MATEBOUND) {
+			if (MATE - (score > 0 ? score : -score) <= depth) break;
+		}
+		// the next iteration costs several times this one, don't start what can't finish
+		int64_t softTimeMs = limits.softTimeMs > 0 ? limits.softTimeMs : limits.timeMs / 2;
+		if (softTimeMs > 0 && result.seconds * 1000 > softTimeMs) break;
+	}
+	if (result.depth == 0) result.bestMove = rootMoves[0];
+	this->flushNodes();
+	result.nodes = this->shared.nodes.load(std::memory_order_relaxed);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+	result.nps = result.seconds > 0 ? (uint64_t)(result.nodes / result.seconds) : 0;
+	return result;
+}
+
+void Searcher::flushNodes() {
+	this->shared.nodes.fetch_add(this->nodes - this->flushedNodes, std::memory_order_relaxed);
+	this->flushedNodes = this->nodes;
+}
+
+// Only the main thread looks at the limits, helpers run until it tells them to stop.
+bool Searcher::shouldStop() {
+	this->flushNodes();
+	if (this->shared.stop.load(std::memory_order_relaxed)) return true;
+	if (this->threadIndex != 0) return false;
+	if (this->limits.stop && this->limits.stop->load(std::memory_order_relaxed)) return true;
+	if (this->limits.nodes > 0 && this->shared.nodes.load(std::memory_order_relaxed) >= this->limits.nodes) return true;
+	if (this->limits.timeMs > 0) {
+		auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - this->start).count();
+		if (elapsed >= this->limits.timeMs) return true;
+	}
+	return false;
+}
+
+bool Searcher::isCapture(Move move) const {
+	return move.type() == Move::ENPASSANT || (this->board.pieceOn(move.to()) != Board::EMPTY && move.type() != Move::CASTLING);
+}
+
+MovePicker::MovePicker(Board &board, Move ttMove, const Move killers[2], const int history[64][64], Rng *jitter, bool noisyOnly)
+	: board(board), ttMove(ttMove), history(history), jitter(jitter), noisyOnly(noisyOnly) {
+	this->killers[0] = killers[0];
+	this->killers[1] = killers[1];
+	this->stage = ttMove == Move::none() ? GENERATENOISY : TTMOVE;
+	this->index = 0;
+	this->noisyEnd = 0;
+	this->badIndex = 0;
+	this->killer = 0;
+}
+
+void MovePicker::pickBest(int end) {
+	int best = this->index;
+	for (int i = this->index + 1; i < end; i++) {
+		if (this->scores[i] > this->scores[best]) best = i;
+	}
+	std::swap(this->moves[this->index], this->moves[best]);
+	std::swap(this->scores[this->index], this->scores[best]);
+}
+
+Move MovePicker::next() {
+	while (true) {
+		switch (this->stage) {
+			case TTMOVE:
+				this->stage = GENERATENOISY;
+				if (this->board.isLegal(this->ttMove)) return this->ttMove;
+				break;
+			case GENERATENOISY:
+				this->board.getLegalMoves(this->moves, Board::NOISY);
+				this->noisyEnd = this->moves.size();
+				for (int i = 0; i < this->noisyEnd; i++) {
+					Move move = this->moves[i];
+					uint8_t victim = move.type() == Move::ENPASSANT ? Board::PAWN : Board::pieceType(this->board.pieceOn(move.to()));
+					uint8_t attacker = Board::pieceType(this->board.pieceOn(move.from()));
+					// taking something worth at least the attacker can't lose, the exchange is only needed otherwise
+					int exchange = Board::PIECEVALUES[attacker] > Board::PIECEVALUES[victim] ? this->board.see(move) : 0;
+					if (exchange < 0) {
+						// the only scores below 0
+						this->scores[i] = exchange;
+						continue;
+					}
+					this->scores[i] = Board::PIECEVALUES[victim] * 16 - attacker;
+					if (move.type() == Move::PROMOTION) this->scores[i] += Board::PIECEVALUES[move.promotion()] * 16;
+				}
+				this->stage = GOODNOISY;
+				break;
+			case GOODNOISY:
+				while (this->index < this->noisyEnd) {
+					this->pickBest(this->noisyEnd);
+					if (this->scores[this->index] < 0) break;
+					Move move = this->moves[this->index++];
+					if (move != this->ttMove) return move;
+				}
+				this->badIndex = this->index;
+				this->stage = this->noisyOnly ? DONE : KILLERS;
+				break;
+			case KILLERS:
+				while (this->killer < 2) {
+					Move move = this->killers[this->killer++];
+					if (move != this->ttMove && !this->board.isNoisy(move) && this->board.isLegal(move)) return move;
+				}
+				this->stage = GENERATEQUIET;
+				break;
+			case GENERATEQUIET:
+				this->board.getLegalMoves(this->moves, Board::QUIET);
+				for (int i = this->noisyEnd; i < this->moves.size(); i++) {
+					this->scores[i] = this->history[this->moves[i].from()][this->moves[i].to()];
+					if (this->jitter) this->scores[i] += this->jitter->below(256);
+				}
+				this->index = this->noisyEnd;
+				this->stage = QUIETS;
+				break;
+			case QUIETS:
+				while (this->index < this->moves.size()) {
+					this->pickBest(this->moves.size());
+					Move move = this->moves[this->index++];
+					if (move != this->ttMove && move != this->killers[0] && move != this->killers[1]) return move;
+				}
+				this->index = this->badIndex;
+				this->stage = BADNOISY;
+				break;
+			case BADNOISY:
+				while (this->index < this->noisyEnd) {
+					this->pickBest(this->noisyEnd);
+					Move move = this->moves[this->index++];
+					if (move != this->ttMove) return move;
+				}
+				this->stage = DONE;
+				break;
+			default:
+				return Move::none();
+		}
+	}
+}
+
+int Searcher::negamax(int depth, int ply, int alpha, int beta) {
+	PROFILE_SCOPE(NEGAMAX);
+	this->pvLength[ply] = ply;
+	if (depth <= 0) return this->quiescence(ply, alpha, beta);
+	this->nodes++;
+	if (this->nodes % CHECKINTERVAL == 0 && this->shouldStop()) this->stopped = true;
+	if (this->stopped) return 0;
+
+	bool root = ply == 0;
+	if (!root) {
+		if (this->board.getPliesForDraw() >= 100 || this->board.repetitionCount() >= 1 || this->board.hasInsufficientMaterial()) return 0;
+		if (ply >= MAXPLY - 1) return this->board.evaluate();
+		Tablebase::Result known;
+		if (Tablebase::probe(this->board, known)) {
+			if (known.wdl == 0) return 0;
+			return known.wdl > 0 ? MATE - ply - known.plies : -MATE + ply + known.plies;
+		}
+	}
+
+	Move ttMove = Move::none();
+	TTHit hit;
+	if (this->tt.probe(this->board.getKey(), hit)) {
+		ttMove = entryMove(hit.payload);
+		int ttScore = scoreFromTT(entryScore(hit.payload), ply);
+		if (!root && hit.depth >= depth) {
+			if (hit.bound == TranspositionTable::BOUND_EXACT) return ttScore;
+			if (hit.bound == TranspositionTable::BOUND_LOWER && ttScore >= beta) return ttScore;
+			if (hit.bound == TranspositionTable::BOUND_UPPER && ttScore <= alpha) return ttScore;
+		}
+	}
+
+	bool inCheck = this->board.isInCheck(this->board.getSideToMove());
+	if (inCheck) depth++;
+
+	// helper threads shuffle the quiet moves a little so they don't all search the same tree
+	MovePicker picker(this->board, ttMove, this->killers[ply], this->history[this->board.getSideToMove()], this->threadIndex != 0 ? &this->rng : nullptr, false);
+	int originalAlpha = alpha;
+	int best = -INFINITE;
+	Move bestMove = Move::none();
+	int searched = 0;
+	for (Move move = picker.next(); move != Move::none(); move = picker.next()) {
+		bool quiet = !this->isCapture(move) && move.type() != Move::PROMOTION;
+		this->board.play(move);
+		int score;
+		if (searched++ == 0) {
+			score = -this->negamax(depth - 1, ply + 1, -beta, -alpha);
+		} else {
+			// principal variation search: prove the move is worse with a null window first
+			score = -this->negamax(depth - 1, ply + 1, -alpha - 1, -alpha);
+			if (score > alpha && score < beta) score = -this->negamax(depth - 1, ply + 1, -beta, -alpha);
+		}
+		this->board.unplay();
+		if (this->stopped) return 0;
+
+		if (score > best) {
+			best = score;
+			bestMove = move;
+			if (score > alpha) {
+				alpha = score;
+				this->pv[ply][ply] = move;
+				for (int j = ply + 1; j < this->pvLength[ply + 1]; j++) {
+					this->pv[ply][j] = this->pv[ply + 1][j];
+				}
+				this->pvLength[ply] = this->pvLength[ply + 1];
+				if (score >= beta) {
+					if (quiet) {
+						if (move != this->killers[ply][0]) {
+							this->killers[ply][1] = this->killers[ply][0];
+							this->killers[ply][0] = move;
+						}
+						int &entry = this->history[this->board.getSideToMove()][move.from()][move.to()];
+						entry += depth * depth;
+						if (entry > (1 << 20)) {
+							for (int s = 0; s < 2; s++) {
+								for (int from = 0; from < 64; from++) {
+									for (int to = 0; to < 64; to++) {
+										this->history[s][from][to] /= 2;
+									}
+								}
+							}
+						}
+					}
+					break;
+				}
+			}
+		}
+	}
+	if (searched == 0) return inCheck ? -MATE + ply : 0;
+
+	uint8_t bound = best >= beta ? TranspositionTable::BOUND_LOWER : (best > originalAlpha ? TranspositionTable::BOUND_EXACT : TranspositionTable::BOUND_UPPER);
+	this->tt.store(this->board.getKey(), depth, bound, packEntry(bestMove, scoreToTT(best, ply)));
+	return best;
+}
+
+int Searcher::quiescence(int ply, int alpha, int beta) {
+	PROFILE_SCOPE(QUIESCENCE);
+	this->pvLength[ply] = ply;
+	this->nodes++;
+	if (this->nodes % CHECKINTERVAL == 0 && this->shouldStop()) this->stopped = true;
+	if (this->stopped) return 0;
+	if (ply >= MAXPLY - 1) return this->board.evaluate();
+
+	bool inCheck = this->board.isInCheck(this->board.getSideToMove());
+	int best = -INFINITE;
+	if (!inCheck) {
+		// stand pat: the side to move can usually do at least as well as doing nothing
+		best = this->board.evaluate();
+		if (best >= beta) return best;
+		if (best > alpha) alpha = best;
+	}
+
+	// out of check only the captures that don't lose material, nothing else beats standing pat
+	MovePicker picker(this->board, Move::none(), this->killers[ply], this->history[this->board.getSideToMove()], nullptr, !inCheck);
+	int searched = 0;
+	for (Move move = picker.next(); move != Move::none(); move = picker.next()) {
+		searched++;
+		if (!inCheck && !this->isCapture(move) && !(move.type() == Move::PROMOTION && move.promotion() == Board::QUEEN)) continue;
+		this->board.play(move);
+		int score = -this->quiescence(ply + 1, -beta, -alpha);
+		this->board.unplay();
+		if (this->stopped) return 0;
+		if (score > best) {
+			best = score;
+			if (score > alpha) {
+				alpha = score;
+				if (score >= beta) break;
+			}
+		}
+	}
+	if (inCheck && searched == 0) return -MATE + ply;
+	return best;
+}
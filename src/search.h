@@ -0,0 +1,129 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "board.h"
+#include "tt.h"
+
+struct SearchResult {
+	Move bestMove = Move::none();
+	int score = 0;
+	int depth = 0;
+	uint64_t nodes = 0;
+	double seconds = 0;
+	uint64_t nps = 0;
+	// nodes of the last iteration divided by the nodes of the one before
+	double branchingFactor = 0;
+	std::vector<Move> pv;
+}; // struct SearchResult
+
+struct SearchLimits {
+	int depth = 64;
+	uint64_t nodes = 0;   // 0 means no limit
+	int64_t timeMs = 0;   // 0 means no limit
+	// no new iteration is started past this, 0 means half of timeMs
+	int64_t softTimeMs = 0;
+	int threads = 1;
+	// lets another thread end the search early, e.g. on a UCI stop
+	const std::atomic<bool> *stop = nullptr;
+	// called after every completed iteration, e.g. to print a progress line
+	std::function<void(const SearchResult &)> onIteration;
+}; // struct SearchLimits
+
+// State shared by all threads of one search.
+struct SearchShared {
+	std::atomic<bool> stop{false};
+	std::atomic<uint64_t> nodes{0};
+}; // struct SearchShared
+
+// "cp <centipawns>" or "mate <moves>", the way UCI prints scores
+std::string formatScore(int score);
+
+// Hands out the moves of a node one at a time and only generates them when it gets
+// there, since most nodes cut off after a move or two: the TT move, checked on its
+// own, then captures and promotions that don't lose material by most valuable
+// victim / least valuable attacker, the killers, quiet moves by history, and the
+// captures that lose material last, by how much. With noisyOnly it stops after the
+// good captures, for quiescence.
+class MovePicker {
+	public:
+		MovePicker(Board &board, Move ttMove, const Move killers[2], const int history[64][64], Rng *jitter, bool noisyOnly);
+		// Move::none() once there are no more
+		Move next();
+
+		static constexpr int TTMOVE = 0;
+		static constexpr int GENERATENOISY = 1;
+		static constexpr int GOODNOISY = 2;
+		static constexpr int KILLERS = 3;
+		static constexpr int GENERATEQUIET = 4;
+		static constexpr int QUIETS = 5;
+		static constexpr int BADNOISY = 6;
+		static constexpr int DONE = 7;
+	private:
+		// swaps the best scoring move from index to end into index
+		void pickBest(int end);
+
+		Board &board;
+		Move ttMove;
+		Move killers[2];
+		const int (*history)[64];
+		// helper threads shuffle quiet moves a little
+		Rng *jitter;
+		bool noisyOnly;
+		int stage;
+		int index;
+		// the noisy moves come first in moves, the quiet ones after them
+		int noisyEnd;
+		// where the losing captures start, they wait until the quiet moves are done
+		int badIndex;
+		int killer;
+		MoveList moves;
+		int scores[MoveList::CAPACITY];
+}; // class MovePicker
+
+// One search thread. Thread 0 owns the limits and reports progress, the others
+// are Lazy SMP helpers: they search the same root on their own board with a
+// shifted depth schedule and a slightly shuffled move order, and only help
+// through the transposition table they share with thread 0.
+class Searcher {
+	public:
+		Searcher(Board &board, TranspositionTable &tt, SearchShared &shared, int threadIndex = 0);
+		SearchResult run(const SearchLimits &limits);
+
+		static constexpr int MAXPLY = 128;
+		static constexpr int INFINITE = 32001;
+		static constexpr int MATE = 32000;
+		// scores beyond this are mates, MATE - score being the distance in plies
+		static constexpr int MATEBOUND = MATE - MAXPLY;
+		// nodes between two looks at the clock and the stop flags, well under a millisecond
+		static constexpr uint64_t CHECKINTERVAL = 1024;
+	private:
+		int negamax(int depth, int ply, int alpha, int beta);
+		int quiescence(int ply, int alpha, int beta);
+		bool isCapture(Move move) const;
+		bool shouldStop();
+		void flushNodes();
+
+		Board &board;
+		TranspositionTable &tt;
+		SearchShared &shared;
+		int threadIndex;
+		Rng rng;
+		SearchLimits limits;
+		std::chrono::steady_clock::time_point start;
+		uint64_t nodes;
+		uint64_t flushedNodes;
+		bool stopped;
+		Move killers[MAXPLY][2];
+		int history[2][64][64];
+		Move pv[MAXPLY][MAXPLY];
+		int pvLength[MAXPLY];
+}; // class Searcher
+
+#endif
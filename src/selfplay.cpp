@@ -0,0 +1,134 @@
+#include "selfplay.h"
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "book.h"
+#include "pgn.h"
+#include "tablebase.h"
+
+void SelfPlayStats::addGame(uint8_t result, int gamePlies) {
+	this->games++;
+	this->plies += gamePlies;
+	this->results[result]++;
+	int bucket = gamePlies / BUCKETPLIES;
+	this->lengths[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+}
+
+void SelfPlayStats::merge(const SelfPlayStats &other) {
+	this->games += other.games;
+	this->plies += other.plies;
+	for (int i = 0; i < Board::RESULTCOUNT; i++) {
+		this->results[i] += other.results[i];
+	}
+	for (int i = 0; i < BUCKETS; i++) {
+		this->lengths[i] += other.lengths[i];
+	}
+}
+
+void SelfPlayStats::print() const {
+	static const char *names[Board::RESULTCOUNT] = {"unfinished", "white wins", "black wins", "stalemate", "75-move rule", "repetition", "tablebase draw", "draw", "insufficient"};
+	double games = this->games ? this->games : 1;
+	std::cout << "Games: " << this->games << ", plies: " << this->plies << std::endl;
+	for (int i = 1; i < Board::RESULTCOUNT; i++) {
+		// the results random games can't end in only get a line when they came up
+		if ((i == Board::TABLEBASEDRAW || i == Board::DRAW) && this->results[i] == 0) continue;
+		std::cout << std::setw(14) << names[i] << ": " << std::setw(10) << this->results[i]
+			<< " (" << std::fixed << std::setprecision(2) << 100.0 * this->results[i] / games << "%)" << std::endl;
+	}
+	std::cout << std::endl << "Game length (plies):" << std::endl;
+	uint64_t largest = 1;
+	for (int i = 0; i < BUCKETS; i++) {
+		if (this->lengths[i] > largest) largest = this->lengths[i];
+	}
+	for (int i = 0; i < BUCKETS; i++) {
+		if (this->lengths[i] == 0) continue;
+		std::cout << std::setw(5) << i * BUCKETPLIES;
+		if (i < BUCKETS - 1) std::cout << "-" << std::setw(4) << (i + 1) * BUCKETPLIES - 1;
+		else std::cout << "+    ";
+		std::cout << ": " << std::setw(10) << this->lengths[i] << " " << std::string(40 * this->lengths[i] / largest, '#') << std::endl;
+	}
+	double seconds = this->seconds > 0 ? this->seconds : 1e-9;
+	std::cout << std::endl << "Average length: " << std::setprecision(1) << this->plies / games << " plies" << std::endl;
+	std::cout << "Time: " << std::setprecision(3) << this->seconds << " s" << std::endl;
+	std::cout << "Games/s: " << std::setprecision(1) << this->games / seconds << std::endl;
+	std::cout << "Plies/s: " << std::setprecision(0) << this->plies / seconds << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+bool runSelfPlay(const SelfPlayOptions &options, SelfPlayStats &total) {
+	std::atomic<uint64_t> nextGame(0);
+	std::atomic<bool> written(true);
+	std::mutex totalMutex;
+	std::unique_ptr<PgnWriter> writer;
+	if (options.pgnPath == "-") writer.reset(new PgnWriter(std::cout));
+	else if (!options.pgnPath.empty()) writer.reset(new PgnWriter(options.pgnPath));
+	if (writer && !writer->isOpen()) return false;
+	bool tablebases = !options.tablebasePath.empty() && Tablebase::load(options.tablebasePath) > 0;
+	OpeningBook book;
+	if (!options.bookPath.empty()) book.open(options.bookPath);
+	auto start = std::chrono::steady_clock::now();
+
+	auto worker = [&]() {
+		SelfPlayStats local;
+		Board board;
+		Rng rng;
+		MoveLog log;
+		PgnTags tags;
+		tags.event = "Random self-play";
+		while (true) {
+			uint64_t game = nextGame.fetch_add(1, std::memory_order_relaxed);
+			if (game >= options.games) break;
+			rng.seed(options.seed * 0x9E3779B97F4A7C15ULL + game);
+			board.setStartingPosition();
+			log.reset();
+			int plies = 0;
+			bool side = Board::WHITE;
+			uint8_t result = Board::ONGOING;
+			Tablebase::Result known;
+			bool inBook = book.isOpen();
+			while (true) {
+				Move move = inBook ? book.pick(board, rng) : Move::none();
+				if (move != Move::none()) board.play(move);
+				else if ((result = board.playRandomMove(rng)) != Board::ONGOING) break;
+				inBook = move != Move::none();
+				if (writer) log.add(board.lastMove());
+				side = !side;
+				plies++;
+				// a won ending counts as won, random moves would mostly throw it away
+				if (tablebases && Tablebase::probe(board, known)) {
+					if (known.wdl == 0) result = Board::TABLEBASEDRAW;
+					else result = (known.wdl > 0) == (side == Board::WHITE) ? Board::WHITEWINS : Board::BLACKWINS;
+					break;
+				}
+			}
+			log.result = result;
+			local.addGame(result, plies);
+			if (writer) {
+				tags.round = std::to_string(game + 1);
+				if (!writer->writeGame(log, tags)) written = false;
+			}
+		}
+		std::lock_guard<std::mutex> lock(totalMutex);
+		total.merge(local);
+	};
+
+	int threads = options.threads > 0 ? options.threads : 1;
+	std::vector<std::thread> pool;
+	for (int i = 1; i < threads; i++) {
+		pool.emplace_back(worker);
+	}
+	worker();
+	for (std::thread &thread : pool) {
+		thread.join();
+	}
+	total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (!writer) return true;
+	writer->flush();
+	return written && writer->isOpen();
+}
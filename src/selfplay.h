@@ -0,0 +1,43 @@
+#ifndef SELFPLAY_H
+#define SELFPLAY_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "board.h"
+
+struct SelfPlayOptions {
+	uint64_t games = 1000;
+	int threads = 1;
+	uint64_t seed = 1;
+	// all games go into this PGN file, "-" for stdout, nothing is written when empty
+	std::string pgnPath;
+	// games stop as soon as they reach a position in these tablebases
+	std::string tablebasePath;
+	// games open with weighted moves from this Polyglot book until they leave it
+	std::string bookPath;
+}; // struct SelfPlayOptions
+
+struct SelfPlayStats {
+	static constexpr int BUCKETPLIES = 50;
+	static constexpr int BUCKETS = 20; // the last bucket collects everything longer
+
+	uint64_t games = 0;
+	uint64_t plies = 0;
+	uint64_t results[Board::RESULTCOUNT] = {0};
+	uint64_t lengths[BUCKETS] = {0};
+	double seconds = 0;
+
+	void addGame(uint8_t result, int gamePlies);
+	void merge(const SelfPlayStats &other);
+	void print() const;
+}; // struct SelfPlayStats
+
+// Plays random games from the starting position, or from book openings, on several threads. Game n is
+// always seeded from (seed, n), so a run is reproducible whatever the thread count.
+// False when the games couldn't be written. A PGN file that can't be opened is
+// caught before any game is played.
+bool runSelfPlay(const SelfPlayOptions &options, SelfPlayStats &stats);
+
+#endif
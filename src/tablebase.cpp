@@ -0,0 +1,600 @@
+#include "tablebase.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+
+using namespace Bitboards;
+
+namespace Tablebase {
+	// A position as a short list of pieces. Captured pieces keep their slot with square NOSQUARE.
+	struct Placement {
+		uint8_t pieces[MAXPIECES];
+		uint8_t squares[MAXPIECES];
+		int count;
+		bool side;
+	}; // struct Placement
+
+	struct FileHeader {
+		char magic[8];
+		char signature[16];
+		uint32_t bits;
+		uint32_t count;
+		uint64_t entries;
+		uint8_t reserved[24];
+	}; // struct FileHeader
+
+	static_assert(sizeof(FileHeader) == 64, "the table data should start 8-byte aligned");
+
+	static constexpr char MAGIC[8] = {'C', 'H', 'E', 'S', 'S', 'T', 'B', '1'};
+	static constexpr uint8_t NOSQUARE = 64;
+	// Values are plies to mate plus one, 0 is a draw. An odd value (even plies) means the side
+	// to move is the one getting mated. ILLEGAL only exists while generating, files store a 0.
+	static constexpr int MAXVALUE = 254;
+	static constexpr uint8_t ILLEGAL = 255;
+	static constexpr uint64_t CHUNK = 1 << 14;
+
+	struct Table {
+		std::string signature;
+		uint8_t pieces[MAXPIECES]; // white first, strongest first
+		int count;
+		uint64_t entries;
+		int bits;
+		const uint8_t *data;
+		std::vector<uint64_t> owned;
+		MappedFile file;
+
+		static int radix(uint8_t piece) {
+			return Board::pieceType(piece) == Board::PAWN ? 48 : 64;
+		}
+		static int base(uint8_t piece) {
+			return Board::pieceType(piece) == Board::PAWN ? 8 : 0;
+		}
+		uint64_t indexOf(const uint8_t squares[], bool side) const {
+			uint64_t index = side;
+			for (int i = 0; i < this->count; i++) {
+				index = index * radix(this->pieces[i]) + squares[i] - base(this->pieces[i]);
+			}
+			return index;
+		}
+		void decode(uint64_t index, uint8_t squares[], bool &side) const {
+			for (int i = this->count - 1; i >= 0; i--) {
+				squares[i] = index % radix(this->pieces[i]) + base(this->pieces[i]);
+				index /= radix(this->pieces[i]);
+			}
+			side = index;
+		}
+		int value(uint64_t index) const {
+			uint64_t bit = index * this->bits;
+			uint64_t word;
+			std::memcpy(&word, this->data + bit / 8, 8);
+			return (word >> (bit % 8)) & ((1ULL << this->bits) - 1);
+		}
+	}; // struct Table
+
+	static std::vector<std::unique_ptr<Table>> tables;
+	static std::unordered_map<uint64_t, const Table *> byMaterial;
+	static int largest = 0;
+
+	static uint8_t flipColor(uint8_t piece) {
+		return piece > Board::WKING ? piece - Board::WKING : piece + Board::WKING;
+	}
+
+	// counts of every piece code, four bits each
+	static uint64_t materialKey(const uint8_t pieces[], int count) {
+		uint64_t key = 0;
+		for (int i = 0; i < count; i++) {
+			key += 1ULL << (4 * pieces[i]);
+		}
+		return key;
+	}
+
+	static std::string nameOf(const uint8_t pieces[], int count) {
+		std::string name = "";
+		for (bool side : {Board::WHITE, Board::BLACK}) {
+			if (side == Board::BLACK) name += 'v';
+			for (int type = Board::KING; type >= Board::PAWN; type--) {
+				for (int i = 0; i < count; i++) {
+					if (pieces[i] == Board::makePiece(side, type)) name += Board::pieces[type];
+				}
+			}
+		}
+		return name;
+	}
+
+	// Sorts the pieces into table order, with the colors swapped first if black has more
+	// (or more valuable) material, so KvKQ and KQvK end up as the same table.
+	static void canonicalize(uint8_t pieces[], int count) {
+		count = std::min(count, MAXPIECES);
+		static const int values[7] = {0, 1, 3, 3, 5, 9, 0};
+		int material[2] = {0, 0}, counts[2] = {0, 0};
+		for (int i = 0; i < count; i++) {
+			bool side = pieces[i] > Board::WKING;
+			material[side] += values[Board::pieceType(pieces[i])];
+			counts[side]++;
+		}
+		bool flip = counts[1] > counts[0] || (counts[1] == counts[0] && material[1] > material[0]);
+		if (counts[1] == counts[0] && material[1] == material[0]) {
+			uint8_t flipped[MAXPIECES];
+			for (int i = 0; i < count; i++) {
+				flipped[i] = flipColor(pieces[i]);
+			}
+			flip = nameOf(flipped, count) < nameOf(pieces, count);
+		}
+		for (int i = 0; i < count && flip; i++) {
+			pieces[i] = flipColor(pieces[i]);
+		}
+		std::sort(pieces, pieces + count, [](uint8_t a, uint8_t b) {
+			if ((a > Board::WKING) != (b > Board::WKING)) return b > Board::WKING;
+			return Board::pieceType(a) > Board::pieceType(b);
+		});
+	}
+
+	static bool parseSignature(const std::string &signature, uint8_t pieces[], int &count) {
+		size_t split = signature.find('v');
+		if (split == std::string::npos) return false;
+		count = 0;
+		for (bool side : {Board::WHITE, Board::BLACK}) {
+			std::string part = side == Board::WHITE ? signature.substr(0, split) : signature.substr(split + 1);
+			if (part.empty() || part[0] != 'K') return false;
+			for (size_t i = 0; i < part.size(); i++) {
+				const char *letter = std::strchr(Board::pieces + 1, part[i]);
+				if (part[i] == '\0' || !letter || letter - Board::pieces > Board::WKING) return false;
+				if ((i > 0 && part[i] == 'K') || count == MAXPIECES) return false;
+				pieces[count++] = Board::makePiece(side, letter - Board::pieces);
+			}
+		}
+		return true;
+	}
+
+	static void registerTable(std::unique_ptr<Table> table) {
+		byMaterial[materialKey(table->pieces, table->count)] = table.get();
+		largest = std::max(largest, table->count);
+		tables.push_back(std::move(table));
+	}
+
+	static Bitboard attacksOf(uint8_t piece, int square, Bitboard occupied) {
+		switch (Board::pieceType(piece)) {
+			case Board::PAWN:
+				return pawnAttacks[piece > Board::WKING][square];
+			case Board::KNIGHT:
+				return knightAttacks[square];
+			case Board::BISHOP:
+				return bishopAttacks(square, occupied);
+			case Board::ROOK:
+				return rookAttacks(square, occupied);
+			case Board::QUEEN:
+				return queenAttacks(square, occupied);
+			default:
+				return kingAttacks[square];
+		}
+	}
+
+	static bool kingAttacked(const Placement &position, bool side, Bitboard occupied) {
+		int king = 0;
+		for (int i = 0; i < position.count; i++) {
+			if (position.pieces[i] == Board::makePiece(side, Board::KING)) king = position.squares[i];
+		}
+		for (int i = 0; i < position.count; i++) {
+			if (position.squares[i] == NOSQUARE || (position.pieces[i] > Board::WKING) == side) continue;
+			if (attacksOf(position.pieces[i], position.squares[i], occupied) & squareBB(king)) return true;
+		}
+		return false;
+	}
+
+	// The value of a position for the side to move, -1 when there is no table for it.
+	static int lookup(const Placement &position) {
+		uint8_t pieces[MAXPIECES], squares[MAXPIECES];
+		int count = 0;
+		for (int i = 0; i < position.count; i++) {
+			if (position.squares[i] == NOSQUARE) continue;
+			pieces[count] = position.pieces[i];
+			squares[count++] = position.squares[i];
+		}
+		if (count == 2) return 0;
+		bool side = position.side;
+		auto found = byMaterial.find(materialKey(pieces, count));
+		if (found == byMaterial.end()) {
+			for (int i = 0; i < count; i++) {
+				pieces[i] = flipColor(pieces[i]);
+				squares[i] ^= 56;
+			}
+			side = !side;
+			found = byMaterial.find(materialKey(pieces, count));
+			if (found == byMaterial.end()) return -1;
+		}
+		// equal pieces can go into their slots in any order, the table has both
+		const Table *table = found->second;
+		uint8_t slots[MAXPIECES];
+		bool used[MAXPIECES] = {false};
+		for (int slot = 0; slot < table->count; slot++) {
+			for (int i = 0; i < count; i++) {
+				if (used[i] || pieces[i] != table->pieces[slot]) continue;
+				used[i] = true;
+				slots[slot] = squares[i];
+				break;
+			}
+		}
+		return table->value(table->indexOf(slots, side));
+	}
+
+	bool probe(const Board &board, Result &result) {
+		if (largest == 0) return false;
+		Bitboard occupied = board.getPieces(Board::WHITE, Board::ALLPIECES) | board.getPieces(Board::BLACK, Board::ALLPIECES);
+		if (popCount(occupied) > largest || board.getCastlingRights() || board.getEnPassantFile() != -1) return false;
+		Placement position;
+		position.count = 0;
+		position.side = board.getSideToMove();
+		while (occupied) {
+			int square = popLsb(occupied);
+			position.pieces[position.count] = board.pieceOn(square);
+			position.squares[position.count++] = square;
+		}
+		int value = lookup(position);
+		if (value < 0) return false;
+		result.plies = value ? value - 1 : 0;
+		result.wdl = value == 0 ? 0 : (result.plies % 2 ? 1 : -1);
+		return true;
+	}
+
+	int maxPieces() {
+		return largest;
+	}
+
+	std::string signatureOf(const Board &board) {
+		uint8_t pieces[64];
+		int count = 0;
+		for (int square = 0; square < 64; square++) {
+			if (board.pieceOn(square) != Board::EMPTY) pieces[count++] = board.pieceOn(square);
+		}
+		return nameOf(pieces, count);
+	}
+
+	static bool loadFile(const std::string &path) {
+		std::unique_ptr<Table> table(new Table());
+		if (!table->file.open(path)) return false;
+		std::string_view view = table->file.view();
+		FileHeader header;
+		if (view.size() < sizeof(header)) return false;
+		std::memcpy(&header, view.data(), sizeof(header));
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) return false;
+		table->signature = std::string(header.signature, strnlen(header.signature, sizeof(header.signature)));
+		if (!parseSignature(table->signature, table->pieces, table->count) || table->count != (int)header.count) return false;
+		if (byMaterial.count(materialKey(table->pieces, table->count))) return false;
+		table->entries = 2;
+		for (int i = 0; i < table->count; i++) {
+			table->entries *= Table::radix(table->pieces[i]);
+		}
+		table->bits = header.bits;
+		uint64_t words = (table->entries * table->bits + 63) / 64 + 1;
+		if (table->entries != header.entries || table->bits < 1 || table->bits > 8 || view.size() < sizeof(header) + words * 8) return false;
+		table->data = (const uint8_t *)view.data() + sizeof(header);
+		registerTable(std::move(table));
+		return true;
+	}
+
+	int load(const std::string &path) {
+		std::error_code error;
+		if (!std::filesystem::is_directory(path, error)) return loadFile(path) ? 1 : 0;
+		int loaded = 0;
+		for (const auto &entry : std::filesystem::directory_iterator(path, error)) {
+			if (entry.path().extension() == ".tb" && loadFile(entry.path().string())) loaded++;
+		}
+		return loaded;
+	}
+
+	template <typename Work>
+	static void parallelFor(uint64_t count, int threads, const Work &work) {
+		std::atomic<uint64_t> next(0);
+		auto worker = [&]() {
+			while (true) {
+				uint64_t start = next.fetch_add(CHUNK, std::memory_order_relaxed);
+				if (start >= count) break;
+				uint64_t end = std::min(start + CHUNK, count);
+				for (uint64_t index = start; index < end; index++) {
+					work(index);
+				}
+			}
+		};
+		std::vector<std::thread> pool;
+		for (int i = 1; i < threads; i++) {
+			pool.emplace_back(worker);
+		}
+		worker();
+		for (std::thread &thread : pool) {
+			thread.join();
+		}
+	}
+
+	// Retrograde analysis in two steps.
+	//
+	// First every position generates its moves once. Moves that capture or promote
+	// leave the table and get their value from a smaller table right away, the
+	// others are only counted.
+	//
+	// Then positions are taken in order of their distance to mate. Un-moves lead
+	// from each one to the positions that could have come before. A position that
+	// can move into a loss is a win one ply later. One whose every move leads to a
+	// win is a loss, once its counter of moves into this table runs out. Whatever
+	// is never reached is a draw.
+	class Generator {
+		public:
+			Generator(Table &table, int threads) : table(table), threads(threads),
+				values(table.entries), counters(table.entries), offTableLoss(table.entries, 0) {
+				// mated positions are the first level
+				this->longest = 1;
+				this->failed = false;
+			}
+
+			bool run() {
+				parallelFor(this->table.entries, this->threads, [this](uint64_t index) {
+					this->initialise(index);
+				});
+				for (int level = 1; level <= this->longest.load() && !this->failed; level++) {
+					parallelFor(this->table.entries, this->threads, [this, level](uint64_t index) {
+						if (this->values[index].load(std::memory_order_relaxed) == level) this->propagate(index, level);
+					});
+				}
+				return !this->failed;
+			}
+
+			int value(uint64_t index) const {
+				uint8_t value = this->values[index].load(std::memory_order_relaxed);
+				return value == ILLEGAL ? 0 : value;
+			}
+			bool isLegal(uint64_t index) const {
+				return this->values[index].load(std::memory_order_relaxed) != ILLEGAL;
+			}
+		private:
+			void setLongest(int value) {
+				int current = this->longest.load(std::memory_order_relaxed);
+				while (value > current && !this->longest.compare_exchange_weak(current, value));
+				if (value > MAXVALUE) this->failed = true;
+			}
+
+			Placement decode(uint64_t index) const {
+				Placement position;
+				position.count = std::min(this->table.count, MAXPIECES);
+				std::copy(this->table.pieces, this->table.pieces + this->table.count, position.pieces);
+				this->table.decode(index, position.squares, position.side);
+				return position;
+			}
+
+			void initialise(uint64_t index) {
+				Placement position = this->decode(index);
+				bool side = position.side;
+				Bitboard occupied = 0, own = 0;
+				for (int i = 0; i < position.count; i++) {
+					Bitboard bb = squareBB(position.squares[i]);
+					if (occupied & bb) {
+						this->values[index] = ILLEGAL;
+						return;
+					}
+					occupied |= bb;
+					if ((position.pieces[i] > Board::WKING) == side) own |= bb;
+				}
+				if (kingAttacked(position, !side, occupied)) {
+					this->values[index] = ILLEGAL;
+					return;
+				}
+
+				int inTable = 0, bestWin = 0, worstLoss = 0;
+				bool canMove = false, canDraw = false;
+				for (int i = 0; i < position.count; i++) {
+					uint8_t piece = position.pieces[i];
+					if ((piece > Board::WKING) != side) continue;
+					int from = position.squares[i];
+					bool pawn = Board::pieceType(piece) == Board::PAWN;
+					Bitboard targets;
+					if (pawn) {
+						int forward = side == Board::WHITE ? 8 : -8;
+						targets = pawnAttacks[side][from] & occupied & ~own;
+						if (!(occupied & squareBB(from + forward))) {
+							targets |= squareBB(from + forward);
+							bool start = from / 8 == (side == Board::WHITE ? 1 : 6);
+							if (start && !(occupied & squareBB(from + 2 * forward))) targets |= squareBB(from + 2 * forward);
+						}
+					} else {
+						targets = attacksOf(piece, from, occupied) & ~own;
+					}
+					while (targets) {
+						int to = popLsb(targets);
+						Placement child = position;
+						child.side = !side;
+						child.squares[i] = to;
+						int captured = -1;
+						for (int j = 0; j < position.count; j++) {
+							if (j != i && position.squares[j] == to) captured = j;
+						}
+						bool capture = captured >= 0;
+						if (capture) child.squares[captured] = NOSQUARE;
+						if (kingAttacked(child, side, (occupied ^ squareBB(from)) | squareBB(to))) continue;
+						canMove = true;
+						bool promotion = pawn && (to < 8 || to >= 56);
+						if (!capture && !promotion) {
+							inTable++;
+							continue;
+						}
+						for (int type = Board::QUEEN; type >= Board::KNIGHT; type--) {
+							if (promotion) child.pieces[i] = Board::makePiece(side, type);
+							int value = lookup(child);
+							if (value < 0) {
+								this->failed = true;
+							} else if (value == 0) {
+								canDraw = true;
+							} else if (value % 2) {
+								if (!bestWin || value + 1 < bestWin) bestWin = value + 1;
+							} else {
+								worstLoss = std::max(worstLoss, value + 1);
+							}
+							if (!promotion) break;
+						}
+					}
+				}
+
+				if (!canMove) {
+					// mated, or stalemate which simply never gets a value
+					if (kingAttacked(position, side, occupied)) this->values[index] = 1;
+					return;
+				}
+				// a drawing way out means this can never be lost
+				this->counters[index] = inTable + canDraw;
+				this->offTableLoss[index] = worstLoss;
+				if (bestWin) {
+					this->values[index] = bestWin;
+					this->setLongest(bestWin);
+				} else if (inTable == 0 && !canDraw) {
+					this->values[index] = worstLoss;
+					this->setLongest(worstLoss);
+				}
+			}
+
+			void propagate(uint64_t index, int value) {
+				Placement position = this->decode(index);
+				bool mover = !position.side;
+				Bitboard occupied = 0;
+				for (int i = 0; i < position.count; i++) {
+					occupied |= squareBB(position.squares[i]);
+				}
+				for (int i = 0; i < position.count; i++) {
+					uint8_t piece = position.pieces[i];
+					if ((piece > Board::WKING) != mover) continue;
+					int to = position.squares[i];
+					Bitboard origins;
+					if (Board::pieceType(piece) == Board::PAWN) {
+						// pawns only ever pushed to get here, captures came from another table
+						int back = mover == Board::WHITE ? -8 : 8;
+						origins = 0;
+						int from = to + back;
+						if (from >= 8 && from < 56 && !(occupied & squareBB(from))) {
+							origins |= squareBB(from);
+							bool doublePush = to / 8 == (mover == Board::WHITE ? 3 : 4);
+							if (doublePush && !(occupied & squareBB(from + back))) origins |= squareBB(from + back);
+						}
+					} else {
+						origins = attacksOf(piece, to, occupied) & ~occupied;
+					}
+					while (origins) {
+						int from = popLsb(origins);
+						Placement parent = position;
+						parent.side = mover;
+						parent.squares[i] = from;
+						// the side not to move can't be in check
+						if (kingAttacked(parent, !mover, occupied ^ squareBB(to) ^ squareBB(from))) continue;
+						this->update(this->table.indexOf(parent.squares, mover), value);
+					}
+				}
+			}
+
+			void update(uint64_t parent, int childValue) {
+				if (childValue % 2) {
+					uint8_t win = childValue + 1;
+					uint8_t current = this->values[parent].load(std::memory_order_relaxed);
+					while ((current == 0 || current > win) && !this->values[parent].compare_exchange_weak(current, win));
+					this->setLongest(win);
+				} else if (this->counters[parent].fetch_sub(1) == 1) {
+					uint8_t loss = std::max(childValue + 1, (int)this->offTableLoss[parent]);
+					uint8_t undecided = 0;
+					if (this->values[parent].compare_exchange_strong(undecided, loss)) this->setLongest(loss);
+				}
+			}
+
+			Table &table;
+			int threads;
+			std::vector<std::atomic<uint8_t>> values;
+			std::vector<std::atomic<uint8_t>> counters;
+			std::vector<uint8_t> offTableLoss;
+			std::atomic<int> longest;
+			std::atomic<bool> failed;
+	}; // class Generator
+
+	static bool save(const Table &table, const std::string &path) {
+		FileHeader header;
+		std::memset(&header, 0, sizeof(header));
+		std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+		std::strncpy(header.signature, table.signature.c_str(), sizeof(header.signature) - 1);
+		header.bits = table.bits;
+		header.count = table.count;
+		header.entries = table.entries;
+		std::ofstream out(path, std::ios::binary);
+		out.write((const char *)&header, sizeof(header));
+		out.write((const char *)table.owned.data(), table.owned.size() * sizeof(uint64_t));
+		return out.good();
+	}
+
+	bool generate(const std::string &signature, int threads, const std::string &directory, bool verbose) {
+		Bitboards::init();
+		std::unique_ptr<Table> table(new Table());
+		if (!parseSignature(signature, table->pieces, table->count)) return false;
+		canonicalize(table->pieces, table->count);
+		table->signature = nameOf(table->pieces, table->count);
+		if (byMaterial.count(materialKey(table->pieces, table->count))) return true;
+		std::string path = (std::filesystem::path(directory) / (table->signature + ".tb")).string();
+		if (loadFile(path)) return true;
+
+		// first the tables a capture or a promotion leads to
+		for (int i = 0; i < table->count; i++) {
+			if (Board::pieceType(table->pieces[i]) == Board::KING) continue;
+			uint8_t smaller[MAXPIECES];
+			int count = 0;
+			for (int j = 0; j < table->count; j++) {
+				if (j != i) smaller[count++] = table->pieces[j];
+			}
+			if (count > 2 && !generate(nameOf(smaller, count), threads, directory, verbose)) return false;
+			if (Board::pieceType(table->pieces[i]) != Board::PAWN) continue;
+			for (int type = Board::KNIGHT; type <= Board::QUEEN; type++) {
+				uint8_t promoted[MAXPIECES];
+				std::copy(table->pieces, table->pieces + table->count, promoted);
+				promoted[i] = Board::makePiece(table->pieces[i] > Board::WKING, type);
+				if (!generate(nameOf(promoted, table->count), threads, directory, verbose)) return false;
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		table->entries = 2;
+		for (int i = 0; i < table->count; i++) {
+			table->entries *= Table::radix(table->pieces[i]);
+		}
+		Generator generator(*table, threads < 1 ? 1 : threads);
+		if (!generator.run()) return false;
+
+		int largestValue = 1;
+		uint64_t counts[3] = {0, 0, 0};
+		for (uint64_t index = 0; index < table->entries; index++) {
+			int value = generator.value(index);
+			largestValue = std::max(largestValue, value);
+			if (generator.isLegal(index)) counts[value == 0 ? 1 : (value % 2 ? 2 : 0)]++;
+		}
+		table->bits = 1;
+		while ((1 << table->bits) <= largestValue) table->bits++;
+		table->owned.assign((table->entries * table->bits + 63) / 64 + 1, 0);
+		for (uint64_t index = 0; index < table->entries; index++) {
+			uint64_t value = generator.value(index);
+			uint64_t bit = index * table->bits;
+			table->owned[bit / 64] |= value << (bit % 64);
+			if (bit % 64 + table->bits > 64) table->owned[bit / 64 + 1] |= value >> (64 - bit % 64);
+		}
+		table->data = (const uint8_t *)table->owned.data();
+
+		if (verbose) {
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			std::cout << table->signature << ": " << table->entries << " entries, " << counts[0] << " wins, "
+				<< counts[1] << " draws, " << counts[2] << " losses for the side to move, longest mate "
+				<< largestValue - 1 << " plies, " << seconds << " s" << std::endl;
+		}
+		bool saved = save(*table, path);
+		registerTable(std::move(table));
+		return saved;
+	}
+} // namespace Tablebase
@@ -0,0 +1,40 @@
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include <cstdint>
+#include <string>
+
+#include "board.h"
+
+// Endgame tablebases for up to four pieces, kings included, built by retrograde
+// analysis. A table covers one material signature such as "KQvKR" and holds
+// the distance to mate in plies for every placement of the pieces with either
+// side to move. The index is dense: 64 squares per piece, 48 per pawn, side to
+// move on top, so a probe is a little arithmetic and one bit-field read.
+//
+// Tables know nothing about castling, en passant or the 50-move rule. Probes
+// give up on positions with castling rights or an en passant square. Double
+// pawn pushes are scored as if the reply en passant did not exist.
+//
+// Loading and generating are not thread safe, probing is. Load before searching.
+namespace Tablebase {
+	constexpr int MAXPIECES = 4;
+
+	struct Result {
+		int wdl;    // 1 the side to move wins, 0 draw, -1 it gets mated
+		int plies;  // until mate, 0 for draws
+	}; // struct Result
+
+	// Loads one .tb file, or every .tb file in a directory. Returns how many tables were loaded.
+	int load(const std::string &path);
+	// Builds a table like "KRvK" and saves it as <directory>/<signature>.tb. The tables
+	// it converts into by captures and promotions are loaded or built and saved first.
+	bool generate(const std::string &signature, int threads, const std::string &directory, bool verbose = false);
+	bool probe(const Board &board, Result &result);
+	// most pieces in any loaded table, 0 when there are none
+	int maxPieces();
+	// "KQvKR" style, white first, pieces strongest first
+	std::string signatureOf(const Board &board);
+} // namespace Tablebase
+
+#endif
@@ -0,0 +1,295 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <new>
+
+#include "../board.h"
+#include "../random.h"
+
+// usage:
+//   bench [-repeat n] [-time ms] [-positions n] [-out file] [filter]
+// Times the board operations one by one over a fixed set of positions and writes
+// the results to bench_output.txt as well, one tab separated line per benchmark,
+// so runs from different commits can be compared. Only benchmarks whose name
+// contains filter are run.
+// options:
+//   -repeat n      timed runs per benchmark, the median is reported, 7 by default
+//   -time ms       how long one run should take at least, 200 by default
+//   -positions n   random positions added to the fixed ones, 64 by default
+//   -out file      where the results go, bench_output.txt by default
+
+// Every allocation of the program goes through here, so a benchmark can tell how
+// many it caused.
+static std::atomic<uint64_t> allocations(0);
+
+void *operator new(size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	void *memory = std::malloc(size ? size : 1);
+	if (!memory) throw std::bad_alloc();
+	return memory;
+}
+
+void *operator new[](size_t size) {
+	return operator new(size);
+}
+
+void operator delete(void *memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept {
+	std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+	std::free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept {
+	std::free(memory);
+}
+
+static const char *fixedPositions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+	"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+	"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+};
+
+static constexpr uint64_t POSITIONSEED = 20240601;
+static constexpr uint64_t PLAYOUTSEED = 7;
+
+// a position with everything the benchmarks need worked out beforehand
+struct BenchPosition {
+	Board board;
+	std::string fen;
+	std::vector<Coordinates> pieces;
+	Coordinates enemyKing;
+	MoveList moves;
+}; // struct BenchPosition
+
+struct BenchResult {
+	std::string name;
+	double nsPerOp;
+	double bestNsPerOp;
+	double opsPerSecond;
+	double allocationsPerOp;
+	uint64_t opsPerRun;
+}; // struct BenchResult
+
+// one pass over the positions, returns how many operations it did
+typedef std::function<uint64_t()> BenchBody;
+
+struct Benchmark {
+	std::string name;
+	BenchBody body;
+}; // struct Benchmark
+
+// keeps results alive so the compiler can't drop the work
+static volatile uint64_t sink;
+
+static void addPosition(std::vector<BenchPosition> &positions, const std::string &fen) {
+	positions.emplace_back();
+	BenchPosition &position = positions.back();
+	position.board.loadFromFEN(fen);
+	position.fen = position.board.exportFEN();
+	bool side = position.board.getSideToMove();
+	for (uint8_t square = 0; square < 64; square++) {
+		if (position.board.pieceOn(square) != Board::EMPTY) position.pieces.push_back(Coordinates::fromSquare(square));
+	}
+	position.enemyKing = Coordinates::fromSquare(position.board.kingSquare(!side));
+	position.board.getLegalMoves(position.moves);
+}
+
+// the fixed positions, then ones from seeded random games so the set is the same every run
+static std::vector<BenchPosition> makePositions(int randomCount) {
+	std::vector<BenchPosition> positions;
+	positions.reserve(std::size(fixedPositions) + randomCount);
+	for (const char *fen : fixedPositions) {
+		addPosition(positions, fen);
+	}
+	Rng rng(POSITIONSEED);
+	Board board;
+	while ((int)positions.size() < (int)std::size(fixedPositions) + randomCount) {
+		board.setStartingPosition();
+		int plies = 8 + rng.below(80);
+		bool over = false;
+		for (int i = 0; i < plies && !over; i++) {
+			over = board.playRandomMove(rng) != Board::ONGOING;
+		}
+		if (!over) addPosition(positions, board.exportFEN());
+	}
+	return positions;
+}
+
+static double runOnce(const BenchBody &body, uint64_t iterations, uint64_t &ops) {
+	ops = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < iterations; i++) {
+		ops += body();
+	}
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A warmup pass sizes the runs to take at least minSeconds, then the runs are
+// timed one by one. Allocations are only counted during the timed runs.
+static BenchResult measure(const std::string &name, const BenchBody &body, int repeat, double minSeconds) {
+	uint64_t ops;
+	uint64_t iterations = 1;
+	double seconds = runOnce(body, iterations, ops);
+	while (seconds < minSeconds / 4) {
+		iterations *= 2;
+		seconds = runOnce(body, iterations, ops);
+	}
+	iterations = std::max<uint64_t>(1, iterations * minSeconds / seconds);
+
+	std::vector<double> nsPerOp;
+	uint64_t totalOps = 0;
+	uint64_t allocationsBefore = allocations.load();
+	for (int i = 0; i < repeat; i++) {
+		seconds = runOnce(body, iterations, ops);
+		totalOps += ops;
+		nsPerOp.push_back(seconds * 1e9 / std::max<uint64_t>(1, ops));
+	}
+	uint64_t allocated = allocations.load() - allocationsBefore;
+	std::sort(nsPerOp.begin(), nsPerOp.end());
+
+	BenchResult result;
+	result.name = name;
+	result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+	result.bestNsPerOp = nsPerOp[0];
+	result.opsPerSecond = 1e9 / result.nsPerOp;
+	result.allocationsPerOp = (double)allocated / std::max<uint64_t>(1, totalOps);
+	result.opsPerRun = ops;
+	return result;
+}
+
+int main(int argc, char **argv) {
+	int repeat = 7;
+	double minSeconds = 0.2;
+	int randomCount = 64;
+	std::string outPath = "bench_output.txt";
+	std::string filter = "";
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-repeat" && i + 1 < argc) repeat = std::max(1, atoi(argv[++i]));
+		else if (arg == "-time" && i + 1 < argc) minSeconds = std::max(1, atoi(argv[++i])) / 1000.0;
+		else if (arg == "-positions" && i + 1 < argc) randomCount = std::max(0, atoi(argv[++i]));
+		else if (arg == "-out" && i + 1 < argc) outPath = argv[++i];
+		else if (arg[0] == '-') {
+			std::cout << "usage: bench [-repeat n] [-time ms] [-positions n] [-out file] [filter]" << std::endl;
+			return 1;
+		} else filter = arg;
+	}
+
+	std::vector<BenchPosition> positions = makePositions(randomCount);
+	// scratch boards the positions are copied into, reused so their history doesn't allocate again
+	Board scratch, loaded;
+	MoveList moves;
+	Rng rng;
+
+	std::vector<Benchmark> benchmarks;
+	benchmarks.push_back({"getAttacks", [&]() {
+		uint64_t ops = 0, total = 0;
+		for (BenchPosition &position : positions) {
+			for (Coordinates piece : position.pieces) {
+				total += Bitboards::popCount(position.board.getAttacks(piece));
+			}
+			ops += position.pieces.size();
+		}
+		sink = total;
+		return ops;
+	}});
+	benchmarks.push_back({"attacks", [&]() {
+		uint64_t ops = 0, total = 0;
+		for (BenchPosition &position : positions) {
+			for (Coordinates piece : position.pieces) {
+				total += position.board.attacks(piece, position.enemyKing);
+			}
+			ops += position.pieces.size();
+		}
+		sink = total;
+		return ops;
+	}});
+	benchmarks.push_back({"isInCheck", [&]() {
+		uint64_t total = 0;
+		for (BenchPosition &position : positions) {
+			total += position.board.isInCheck(Board::WHITE) + position.board.isInCheck(Board::BLACK);
+		}
+		sink = total;
+		return positions.size() * 2;
+	}});
+	benchmarks.push_back({"getLegalMoves", [&]() {
+		uint64_t total = 0;
+		for (BenchPosition &position : positions) {
+			moves.clear();
+			position.board.getLegalMoves(moves);
+			total += moves.size();
+		}
+		sink = total;
+		return positions.size();
+	}});
+	// one op is a move played and taken back
+	benchmarks.push_back({"play+unplay", [&]() {
+		uint64_t ops = 0, total = 0;
+		for (BenchPosition &position : positions) {
+			for (Move move : position.moves) {
+				position.board.play(move);
+				total += position.board.getKey();
+				position.board.unplay();
+			}
+			ops += position.moves.size();
+		}
+		sink = total;
+		return ops;
+	}});
+	benchmarks.push_back({"fen round trip", [&]() {
+		uint64_t total = 0;
+		for (BenchPosition &position : positions) {
+			loaded.loadFromFEN(position.fen);
+			total += loaded.exportFEN().size();
+		}
+		sink = total;
+		return positions.size();
+	}});
+	// one op is a whole random game from the position to its end, every pass plays the same games
+	benchmarks.push_back({"playout", [&]() {
+		uint64_t total = 0;
+		rng.seed(PLAYOUTSEED);
+		for (BenchPosition &position : positions) {
+			scratch.copyPosition(position.board);
+			total += scratch.playout(rng);
+		}
+		sink = total;
+		return positions.size();
+	}});
+
+	std::ofstream out(outPath);
+	if (!out) {
+		std::cout << "Can't write " << outPath << std::endl;
+		return 1;
+	}
+	out << "# benchmark\tns/op\tbest ns/op\tops/sec\tallocs/op\tops/run" << std::endl;
+	std::cout << positions.size() << " positions, " << repeat << " runs of at least " << (int)(minSeconds * 1000) << " ms each" << std::endl;
+	std::cout << "      benchmark       ns/op  best ns/op         ops/sec  allocs/op" << std::endl;
+	for (const Benchmark &benchmark : benchmarks) {
+		if (benchmark.name.find(filter) == std::string::npos) continue;
+		BenchResult result = measure(benchmark.name, benchmark.body, repeat, minSeconds);
+		std::cout << std::setw(15) << result.name << std::fixed << std::setprecision(1) << std::setw(12) << result.nsPerOp
+			<< std::setw(12) << result.bestNsPerOp << std::setw(16) << std::setprecision(0) << result.opsPerSecond
+			<< std::setw(11) << std::setprecision(3) << result.allocationsPerOp << std::endl;
+		out << result.name << '\t' << std::fixed << std::setprecision(2) << result.nsPerOp << '\t' << result.bestNsPerOp
+			<< '\t' << std::setprecision(0) << result.opsPerSecond << '\t' << std::setprecision(4) << result.allocationsPerOp
+			<< '\t' << result.opsPerRun << std::endl;
+	}
+	return out.good() ? 0 : 1;
+}
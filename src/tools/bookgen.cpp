@@ -0,0 +1,81 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+
+#include "../board.h"
+#include "../book.h"
+
+// usage:
+//   bookgen [-ply n] [-min n] [-memory mb] <book> <pgn>...   compiles the games into a Polyglot book
+//   bookgen probe <book> [fen]                               lists the book moves for a position, the starting position by default
+
+static int probe(const std::string &path, const std::string &fen) {
+	OpeningBook book;
+	if (!book.open(path)) {
+		std::cout << "Can't open " << path << std::endl;
+		return 1;
+	}
+	Board board;
+	if (fen.empty()) {
+		board.setStartingPosition();
+	} else if (!board.loadFromFEN(fen)) {
+		std::cout << "Invalid FEN: " << fen << std::endl;
+		return 1;
+	}
+	std::vector<BookEntry> entries;
+	book.probe(board, entries);
+	std::cout << "Key " << std::hex << std::setw(16) << std::setfill('0') << Polyglot::keyOf(board) << std::dec << std::setfill(' ')
+		<< ", " << entries.size() << " moves among " << book.size() << " entries" << std::endl;
+	uint32_t total = 0;
+	for (const BookEntry &entry : entries) {
+		total += entry.weight;
+	}
+	for (const BookEntry &entry : entries) {
+		Move move = Polyglot::decodeMove(board, entry.move);
+		std::cout << std::setw(8) << (move == Move::none() ? "illegal" : board.toSAN(move)) << std::setw(7) << entry.weight
+			<< std::setw(8) << std::fixed << std::setprecision(2) << 100.0 * entry.weight / (total ? total : 1) << "%" << std::endl;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	BookBuildOptions options;
+	std::vector<std::string> paths;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-ply" && i + 1 < argc) {
+			options.maxPly = atoi(argv[++i]);
+		} else if (arg == "-min" && i + 1 < argc) {
+			options.minGames = atoi(argv[++i]);
+		} else if (arg == "-memory" && i + 1 < argc) {
+			options.memoryMB = atoi(argv[++i]);
+		} else if (arg == "probe" && paths.empty() && i + 1 < argc) {
+			std::string fen = "";
+			for (int j = i + 2; j < argc; j++) {
+				if (j > i + 2) fen += ' ';
+				fen += argv[j];
+			}
+			return probe(argv[i + 1], fen);
+		} else {
+			paths.push_back(arg);
+		}
+	}
+	if (paths.size() < 2) {
+		std::cout << "Usage: bookgen [-ply n] [-min n] [-memory mb] <book> <pgn>... | probe <book> [fen]" << std::endl;
+		return 1;
+	}
+	std::string output = paths[0];
+	paths.erase(paths.begin());
+	BookBuildStats stats;
+	if (!buildBook(paths, output, options, stats)) {
+		std::cout << "Could not build " << output << std::endl;
+		return 1;
+	}
+	std::cout << "Games: " << stats.games << " (" << stats.invalid << " invalid)" << std::endl;
+	std::cout << "Positions: " << stats.positions << " in " << stats.runs << " run(s)" << std::endl;
+	std::cout << "Book entries: " << stats.entries << std::endl;
+	std::cout << "Time: " << std::fixed << std::setprecision(3) << stats.seconds << " s" << std::endl;
+	return 0;
+}
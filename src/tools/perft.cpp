@@ -0,0 +1,172 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+
+#include "../board.h"
+#include "../perft.h"
+
+// usage:
+//   perft [options]                      runs the standard suite up to depth 5
+//   perft [options] suite [depth]        same, with another depth limit
+//   perft [options] <depth> [fen]        prints the node count of every root move (start position without a fen)
+//   perft [options] scaling <depth> [fen]  times the count at 1, 2, 4, ... threads up to -threads
+// options:
+//   -threads n   threads to count with, all cores by default
+//   -hash mb     perft hash size, none by default
+
+struct SuiteEntry {
+	const char *name;
+	const char *fen;
+	uint64_t nodes[7];
+}; // struct SuiteEntry
+
+// node counts for depths 1 to 6, 0 where the reference value is too slow to be worth listing
+static const SuiteEntry suite[] = {
+	{"initial", "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		{0, 20, 400, 8902, 197281, 4865609, 119060324}},
+	{"kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		{0, 48, 2039, 97862, 4085603, 193690690, 0}},
+	{"position 3", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		{0, 14, 191, 2812, 43238, 674624, 11030083}},
+	{"position 4", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		{0, 6, 264, 9467, 422333, 15833292, 706045033}},
+	{"position 4 mirrored", "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1",
+		{0, 6, 264, 9467, 422333, 15833292, 706045033}},
+	{"position 5", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		{0, 44, 1486, 62379, 2103487, 89941194, 0}},
+	{"position 6", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		{0, 46, 2079, 89890, 3894594, 164075551, 0}},
+};
+
+static double elapsedSeconds(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uint64_t countNodes(Board &board, int depth, const PerftOptions &options) {
+	uint64_t nodes = 0;
+	for (const PerftDivide &move : perftDivide(board, depth, options)) {
+		nodes += move.nodes;
+	}
+	return nodes;
+}
+
+static int runSuite(int maxDepth, const PerftOptions &options) {
+	int failures = 0;
+	uint64_t totalNodes = 0;
+	auto suiteStart = std::chrono::steady_clock::now();
+	for (const SuiteEntry &entry : suite) {
+		Board board;
+		if (!board.loadFromFEN(entry.fen)) {
+			std::cout << entry.name << ": could not parse " << entry.fen << std::endl;
+			failures++;
+			continue;
+		}
+		for (int depth = 1; depth <= maxDepth && depth <= 6; depth++) {
+			if (entry.nodes[depth] == 0) break;
+			auto start = std::chrono::steady_clock::now();
+			uint64_t nodes = countNodes(board, depth, options);
+			double seconds = elapsedSeconds(start);
+			totalNodes += nodes;
+			bool ok = nodes == entry.nodes[depth];
+			if (!ok) failures++;
+			std::cout << (ok ? "ok   " : "FAIL ") << entry.name << " depth " << depth << ": " << nodes;
+			if (!ok) std::cout << " (expected " << entry.nodes[depth] << ")";
+			std::cout << ", " << (uint64_t)(nodes / (seconds > 0 ? seconds : 1e-9)) << " nps" << std::endl;
+		}
+	}
+	double seconds = elapsedSeconds(suiteStart);
+	std::cout << std::endl << "Nodes: " << totalNodes << std::endl;
+	std::cout << "Time: " << (uint64_t)(seconds * 1000) << " ms" << std::endl;
+	std::cout << "NPS: " << (uint64_t)(totalNodes / (seconds > 0 ? seconds : 1e-9)) << std::endl;
+	std::cout << (failures == 0 ? "All counts match." : std::to_string(failures) + " count(s) differ.") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
+
+static bool setUp(Board &board, const std::string &fen) {
+	if (fen.empty()) {
+		board.setStartingPosition();
+		return true;
+	}
+	if (board.loadFromFEN(fen)) return true;
+	std::cout << "Invalid FEN: " << fen << std::endl;
+	return false;
+}
+
+static int runDivide(int depth, const std::string &fen, const PerftOptions &options) {
+	Board board;
+	if (!setUp(board, fen)) return 1;
+	auto start = std::chrono::steady_clock::now();
+	std::vector<PerftDivide> divide = perftDivide(board, depth, options);
+	double seconds = elapsedSeconds(start);
+	uint64_t nodes = 0;
+	for (const PerftDivide &entry : divide) {
+		std::cout << entry.move << ": " << entry.nodes << std::endl;
+		nodes += entry.nodes;
+	}
+	std::cout << std::endl << "Moves: " << divide.size() << std::endl;
+	std::cout << "Nodes: " << nodes << std::endl;
+	std::cout << "Time: " << (uint64_t)(seconds * 1000) << " ms" << std::endl;
+	std::cout << "NPS: " << (uint64_t)(nodes / (seconds > 0 ? seconds : 1e-9)) << std::endl;
+	return 0;
+}
+
+// The counts have to agree at every thread count, otherwise the split is broken.
+static int runScaling(int depth, const std::string &fen, const PerftOptions &options) {
+	Board board;
+	if (!setUp(board, fen)) return 1;
+	std::cout << "threads   time (s)         nodes           nps  speedup" << std::endl;
+	double baseSeconds = 0;
+	uint64_t baseNodes = 0;
+	PerftOptions run = options;
+	for (run.threads = 1; ; run.threads = std::min(run.threads * 2, options.threads)) {
+		auto start = std::chrono::steady_clock::now();
+		uint64_t nodes = countNodes(board, depth, run);
+		double seconds = elapsedSeconds(start);
+		if (run.threads == 1) {
+			baseSeconds = seconds;
+			baseNodes = nodes;
+		}
+		std::cout << std::setw(7) << run.threads << std::setw(11) << std::fixed << std::setprecision(3) << seconds
+			<< std::setw(14) << nodes << std::setw(14) << (uint64_t)(nodes / (seconds > 0 ? seconds : 1e-9))
+			<< std::setw(9) << std::setprecision(2) << baseSeconds / (seconds > 0 ? seconds : 1e-9) << std::endl;
+		if (nodes != baseNodes) {
+			std::cout << "Node count differs from the single threaded one." << std::endl;
+			return 1;
+		}
+		if (run.threads == options.threads) break;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	PerftOptions options;
+	options.threads = std::thread::hardware_concurrency();
+	std::vector<std::string> args;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-threads" && i + 1 < argc) options.threads = atoi(argv[++i]);
+		else if (arg == "-hash" && i + 1 < argc) options.hashMB = atoi(argv[++i]);
+		else args.push_back(arg);
+	}
+	if (options.threads < 1) options.threads = 1;
+	if (args.empty()) return runSuite(5, options);
+	std::string mode = args[0];
+	if (mode == "suite") return runSuite(args.size() > 1 ? atoi(args[1].c_str()) : 5, options);
+	bool scaling = mode == "scaling";
+	if (scaling) args.erase(args.begin());
+	int depth = args.empty() ? 0 : atoi(args[0].c_str());
+	if (depth < 1) {
+		std::cout << "usage: perft [-threads n] [-hash mb] [suite [depth] | <depth> [fen] | scaling <depth> [fen]]" << std::endl;
+		return 1;
+	}
+	std::string fen = "";
+	for (size_t i = 1; i < args.size(); i++) {
+		if (i > 1) fen += ' ';
+		fen += args[i];
+	}
+	return scaling ? runScaling(depth, fen, options) : runDivide(depth, fen, options);
+}
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdlib>
+
+#include "../board.h"
+#include "../tablebase.h"
+
+// usage:
+//   tbgen [-threads n] [-dir path] <signature>...   builds tables and everything they depend on, e.g. tbgen KQvK KRvK KPvK
+//   tbgen [-threads n] [-dir path] all3|all4         every table with three, or up to four, pieces
+//   tbgen [-dir path] probe <fen>                    looks a position up in the tables found in the directory
+
+static std::vector<std::string> allSignatures(int pieces) {
+	static const char *extra = "QRBNP";
+	std::vector<std::string> signatures;
+	for (int a = 0; a < 5; a++) {
+		signatures.push_back(std::string("K") + extra[a] + "vK");
+	}
+	if (pieces < 4) return signatures;
+	for (int a = 0; a < 5; a++) {
+		for (int b = a; b < 5; b++) {
+			signatures.push_back(std::string("K") + extra[a] + extra[b] + "vK");
+		}
+		for (int b = 0; b < 5; b++) {
+			signatures.push_back(std::string("K") + extra[a] + "vK" + extra[b]);
+		}
+	}
+	return signatures;
+}
+
+static int probe(const std::string &directory, const std::string &fen) {
+	int loaded = Tablebase::load(directory);
+	Board board;
+	if (!board.loadFromFEN(fen)) {
+		std::cout << "Invalid FEN: " << fen << std::endl;
+		return 1;
+	}
+	Tablebase::Result result;
+	if (!Tablebase::probe(board, result)) {
+		std::cout << "No table for " << Tablebase::signatureOf(board) << " among " << loaded << " loaded" << std::endl;
+		return 1;
+	}
+	std::string side = board.getSideToMove() == Board::WHITE ? "White" : "Black";
+	if (result.wdl == 0) std::cout << "Draw" << std::endl;
+	else if (result.wdl > 0) std::cout << side << " mates in " << (result.plies + 1) / 2 << " (" << result.plies << " plies)" << std::endl;
+	else std::cout << side << " gets mated in " << result.plies / 2 << " (" << result.plies << " plies)" << std::endl;
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	int threads = std::thread::hardware_concurrency();
+	std::string directory = ".";
+	std::vector<std::string> signatures;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		if (arg == "-threads" && i + 1 < argc) {
+			threads = atoi(argv[++i]);
+		} else if (arg == "-dir" && i + 1 < argc) {
+			directory = argv[++i];
+		} else if (arg == "probe") {
+			std::string fen = "";
+			for (int j = i + 1; j < argc; j++) {
+				if (j > i + 1) fen += ' ';
+				fen += argv[j];
+			}
+			return probe(directory, fen);
+		} else if (arg == "all3" || arg == "all4") {
+			std::vector<std::string> all = allSignatures(arg == "all3" ? 3 : 4);
+			signatures.insert(signatures.end(), all.begin(), all.end());
+		} else {
+			signatures.push_back(arg);
+		}
+	}
+	if (signatures.empty()) {
+		std::cout << "Usage: tbgen [-threads n] [-dir path] <signature>... | all3 | all4 | probe <fen>" << std::endl;
+		return 1;
+	}
+	for (const std::string &signature : signatures) {
+		if (!Tablebase::generate(signature, threads, directory, true)) {
+			std::cout << "Could not build " << signature << std::endl;
+			return 1;
+		}
+	}
+	return 0;
+}
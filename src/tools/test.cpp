@@ -0,0 +1,326 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <cstdio>
+#include <iterator>
+
+#include "../board.h"
+#include "../book.h"
+#include "../packed.h"
+#include "../pgn.h"
+#include "../random.h"
+#include "../tt.h"
+
+// usage:
+//   test [filter]
+// Regression checks for what perft doesn't cover: the FEN parser, static exchange
+// evaluation, packed positions, SAN and PGN output and the Polyglot keys. Only
+// groups whose name contains filter are run. Prints every failure and exits with
+// 1 if there was one. make test runs this after the perft suite.
+
+static int checks = 0;
+static int failures = 0;
+
+static void check(bool ok, const std::string &what) {
+	checks++;
+	if (ok) return;
+	failures++;
+	std::cout << "FAIL " << what << std::endl;
+}
+
+// the legal move with this UCI name, Move::none() when there is none
+static Move findMove(Board &board, const std::string &uci) {
+	MoveList moves;
+	board.getLegalMoves(moves);
+	for (Move move : moves) {
+		if (Board::toUCI(move) == uci) return move;
+	}
+	return Move::none();
+}
+
+static void testFEN() {
+	static const char *valid[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"4k3/8/8/8/8/8/8/4K2R w K - 5 40",
+		"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 2",
+		"4k3/8/8/8/8/8/8/4K3 w - - 150 80",
+		"4k3/8/8/8/8/8/8/4K3 b - - 0 65535",
+	};
+	static const char *invalid[] = {
+		"",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 x",
+		"rnbqkbnr/pppppppp/9/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"rnbqkbnr/pppppppp/71/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP w KQkq - 0 1",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR x KQkq - 0 1",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkqK - 0 1",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - a 1",
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 0",
+		// en passant on the wrong rank, and without the pawn that just moved
+		"rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e6 0 1",
+		"4k3/8/8/8/8/8/8/4K3 w - d6 0 1",
+		// castling rights without the rook or the king at home
+		"4k3/8/8/8/8/8/8/4K2R w Q - 5 40",
+		"4k3/8/8/8/8/8/8/3K3R w K - 5 40",
+		// the side that just moved is in check, two kings, a pawn on the last rank
+		"4k2R/8/8/8/8/8/8/4K3 w - - 5 40",
+		"4k3/8/8/8/8/8/8/3KK3 w - - 0 1",
+		"4k2P/8/8/8/8/8/8/4K3 w - - 0 1",
+		// past the 75-move rule, a move number that would overflow the ply count
+		"4k3/8/8/8/8/8/8/4K3 w - - 151 80",
+		"4k3/8/8/8/8/8/8/4K3 b - - 0 65536",
+		"4k3/8/8/8/8/8/8/4K3 b - - 0 2000000000",
+	};
+	Board board;
+	for (const char *fen : valid) {
+		check(board.loadFromFEN(fen) && board.exportFEN() == fen, std::string("FEN round trip ") + fen);
+	}
+	for (const char *fen : invalid) {
+		check(!board.loadFromFEN(fen), std::string("FEN accepted ") + fen);
+	}
+	// the counters are optional, and an en passant square nobody can take on isn't kept
+	check(board.loadFromFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq -")
+		&& board.exportFEN() == "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "FEN without counters");
+	check(board.loadFromFEN("rnbqkbnr/pppppppp/8/8/4P3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 1") && board.getEnPassantFile() == -1,
+		"FEN en passant square without a pawn to take");
+}
+
+static void testSEE() {
+	static const struct {
+		const char *fen;
+		const char *move;
+		int value;
+	} cases[] = {
+		{"1k1r4/1pp4p/p7/4p3/8/P5P1/1PP4P/2K1R3 w - - 0 1", "e1e5", 100},
+		{"1k1r3q/1ppn3p/p4b2/4p3/8/P2N2P1/1PP1R1BP/2K1Q3 w - - 0 1", "d3e5", -220},
+		{"4k3/8/8/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 100},
+		{"4k3/8/2p5/3p4/4P3/8/8/4K3 w - - 0 1", "e4d5", 0},
+		{"4k3/8/2p5/3q4/4P3/8/8/4K3 w - - 0 1", "e4d5", 800},
+		{"4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1", "d2d5", 100},
+		{"4k3/3r4/3r4/3p4/8/8/3R4/3QK3 w - - 0 1", "d2d5", -400},
+		// the king may only take last
+		{"3k4/8/8/3p4/4K3/8/8/8 w - - 0 1", "e4d5", 100},
+		{"4k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q", 800},
+		{"1r2k3/P7/8/8/8/8/8/4K3 w - - 0 1", "a7b8q", 1300},
+		{"r3k3/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q", -100},
+		{"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", 100},
+	};
+	Board board;
+	for (const auto &entry : cases) {
+		std::string name = std::string("SEE ") + entry.fen + " " + entry.move;
+		board.loadFromFEN(entry.fen);
+		Move move = findMove(board, entry.move);
+		if (move == Move::none()) {
+			check(false, name + ": no such move");
+			continue;
+		}
+		int value = board.see(move);
+		check(value == entry.value, name + ": " + std::to_string(value) + ", expected " + std::to_string(entry.value));
+	}
+}
+
+static void testPacked() {
+	// every position of some random games survives a round trip
+	Board board, unpacked;
+	Rng rng(11);
+	int bad = 0;
+	for (int game = 0; game < 200; game++) {
+		board.setStartingPosition();
+		while (board.playRandomMove(rng) == Board::ONGOING) {
+			PackedPosition packed = board.pack(17, Board::ONGOING);
+			if (!unpacked.unpack(packed) || unpacked.exportFEN() != board.exportFEN()) bad++;
+		}
+	}
+	check(bad == 0, "pack round trip, " + std::to_string(bad) + " positions differ");
+
+	// records that no legal position packs into
+	static const struct {
+		const char *name;
+		const char *fen;
+		void (*corrupt)(PackedPosition &);
+	} cases[] = {
+		{"a piece code past BKING", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.pieces[0] |= 13; }},
+		{"no black king", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.pieces[0] = Board::WKING | (Board::WKING << 4); }},
+		{"castling without its rook", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.flags |= 2; }},
+		{"castling with the king away", "r3k2r/8/8/8/8/8/8/R4K1R w kq - 0 1", [](PackedPosition &packed) { packed.flags |= 6; }},
+		{"en passant without a pawn", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.enPassant = 3; }},
+		{"en passant nobody can take", "4k3/8/8/3p4/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.enPassant = 3; }},
+		{"en passant past file h", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.enPassant = 8; }},
+		{"half moves past 150", "4k3/8/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.halfMoves = 151; }},
+		{"the side that moved in check", "4k3/4r3/8/8/8/8/8/4K3 w - - 0 1", [](PackedPosition &packed) { packed.flags |= 1; }},
+	};
+	for (const auto &entry : cases) {
+		board.loadFromFEN(entry.fen);
+		PackedPosition packed = board.pack(0, Board::ONGOING);
+		check(unpacked.unpack(packed), std::string("unpack of the uncorrupted record for ") + entry.name);
+		entry.corrupt(packed);
+		check(!unpacked.unpack(packed), std::string("unpack accepted ") + entry.name);
+	}
+}
+
+static void testSAN() {
+	static const struct {
+		const char *fen;
+		const char *move;
+		const char *san;
+	} cases[] = {
+		{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "g1f3", "Nf3"},
+		{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", "e2e4", "e4"},
+		{"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "e1g1", "O-O"},
+		{"r3k2r/8/8/8/8/8/8/R3K2R w KQkq - 0 1", "e1c1", "O-O-O"},
+		{"4k3/8/8/3pP3/8/8/8/4K3 w - d6 0 1", "e5d6", "exd6"},
+		{"3k4/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8q", "b8=Q+"},
+		{"3k4/1P6/8/8/8/8/8/4K3 w - - 0 1", "b7b8n", "b8=N"},
+		{"4k3/8/8/8/8/8/K7/R6R w - - 0 1", "a1d1", "Rad1"},
+		{"4k3/8/8/8/8/R7/8/R3K3 w - - 0 1", "a1a2", "R1a2"},
+		{"4k3/8/8/2N5/8/2N3N1/8/4K3 w - - 0 1", "c3e4", "Nc3e4"},
+		{"6k1/5ppp/8/8/8/8/8/R5K1 w - - 0 1", "a1a8", "Ra8#"},
+	};
+	Board board;
+	for (const auto &entry : cases) {
+		std::string name = std::string("SAN ") + entry.fen + " " + entry.move;
+		board.loadFromFEN(entry.fen);
+		Move move = findMove(board, entry.move);
+		if (move == Move::none()) {
+			check(false, name + ": no such move");
+			continue;
+		}
+		std::string san = board.toSAN(move);
+		check(san == entry.san, name + ": " + san + ", expected " + entry.san);
+		check(board.fromSAN(entry.san) == move, name + ": " + entry.san + " doesn't parse back");
+	}
+}
+
+static void testPGN() {
+	// every result a game can end in
+	static const struct {
+		uint8_t result;
+		const char *text;
+	} results[] = {
+		{Board::ONGOING, "*"},
+		{Board::WHITEWINS, "1-0"},
+		{Board::BLACKWINS, "0-1"},
+		{Board::STALEMATE, "1/2-1/2"},
+		{Board::SEVENTYFIVEMOVES, "1/2-1/2"},
+		{Board::REPETITION, "1/2-1/2"},
+		{Board::TABLEBASEDRAW, "1/2-1/2"},
+		{Board::DRAW, "1/2-1/2"},
+		{Board::INSUFFICIENTMATERIAL, "1/2-1/2"},
+	};
+	check(std::size(results) == Board::RESULTCOUNT, "PGN results, a Board result isn't listed here");
+	for (const auto &entry : results) {
+		check(std::string(PgnWriter::resultString(entry.result)) == entry.text,
+			"PGN result " + std::to_string(entry.result) + ": " + PgnWriter::resultString(entry.result) + ", expected " + entry.text);
+	}
+
+	// fool's mate, the result comes from the final position
+	MoveLog log;
+	Board board;
+	board.setStartingPosition();
+	for (const char *uci : {"f2f3", "e7e5", "g2g4", "d8h4"}) {
+		Move move = findMove(board, uci);
+		log.add(move);
+		board.play(move);
+	}
+	std::string text;
+	check(PgnWriter::formatGame(log, PgnTags(), text), "PGN fool's mate formats");
+	check(text.find("[Result \"0-1\"]") != std::string::npos, "PGN fool's mate result tag");
+	check(text.find("\n1. f3 e5 2. g4 Qh4# 0-1\n") != std::string::npos, "PGN fool's mate move text:\n" + text);
+
+	// a game from a FEN ending in a draw by insufficient material, black to move first
+	log.reset("4k3/8/8/8/8/8/pK6/8 b - - 0 30");
+	board.loadFromFEN(log.startFEN);
+	for (const char *uci : {"a2a1q", "b2a1"}) {
+		Move move = findMove(board, uci);
+		log.add(move);
+		board.play(move);
+	}
+	text.clear();
+	check(PgnWriter::formatGame(log, PgnTags(), text), "PGN game from a FEN formats");
+	check(text.find("[Result \"1/2-1/2\"]") != std::string::npos, "PGN insufficient material result tag");
+	check(text.find("[SetUp \"1\"]\n[FEN \"4k3/8/8/8/8/8/pK6/8 b - - 0 30\"]") != std::string::npos, "PGN FEN tags");
+	check(text.find("\n30... a1=Q+ 31. Kxa1 1/2-1/2\n") != std::string::npos, "PGN move text from a FEN:\n" + text);
+
+	// a start FEN that doesn't load neither formats nor counts as written
+	log.reset("4k3/8/8/8/8/8/pK6/8 b - - 0");
+	text.clear();
+	check(!PgnWriter::formatGame(log, PgnTags(), text) && text.empty(), "PGN formatted a game from a bad FEN");
+	std::ostringstream out;
+	PgnWriter writer(out);
+	check(!writer.writeGame(log, PgnTags()) && writer.getGames() == 0, "PGN wrote a game from a bad FEN");
+}
+
+// a shallow bound doesn't push a deeper entry for the same position out
+static void testTT() {
+	TranspositionTable tt(1);
+	TTHit hit;
+	uint64_t key = 0x123456789ABCDEFULL;
+	tt.store(key, 10, TranspositionTable::BOUND_LOWER, 1);
+	tt.store(key, 3, TranspositionTable::BOUND_UPPER, 2);
+	check(tt.probe(key, hit) && hit.depth == 10 && hit.payload == 1, "TT shallow bound replaced a deeper entry");
+	tt.store(key, 10 - TranspositionTable::KEEPMARGIN, TranspositionTable::BOUND_UPPER, 3);
+	check(tt.probe(key, hit) && hit.depth == 10 - TranspositionTable::KEEPMARGIN && hit.payload == 3, "TT bound within the margin kept out");
+	tt.store(key, 1, TranspositionTable::BOUND_EXACT, 4);
+	check(tt.probe(key, hit) && hit.payload == 4 && hit.bound == TranspositionTable::BOUND_EXACT, "TT exact score kept out");
+	tt.store(key, 10, TranspositionTable::BOUND_LOWER, 5);
+	tt.newGeneration();
+	tt.store(key, 1, TranspositionTable::BOUND_UPPER, 6);
+	check(tt.probe(key, hit) && hit.depth == 1 && hit.payload == 6, "TT entry from an older search kept out");
+}
+
+// the reference keys from the Polyglot book format description
+static void testPolyglot() {
+	static const struct {
+		const char *moves;
+		uint64_t key;
+	} cases[] = {
+		{"", 0x463b96181691fc9cULL},
+		{"e2e4", 0x823c9b50fd114196ULL},
+		{"e2e4 d7d5", 0x0756b94461c50fb0ULL},
+		{"e2e4 d7d5 e4e5", 0x662fafb965db29d4ULL},
+		{"e2e4 d7d5 e4e5 f7f5", 0x22a48b5a8e47ff78ULL},
+		{"e2e4 d7d5 e4e5 f7f5 e1e2", 0x652a607ca3f242c1ULL},
+		{"e2e4 d7d5 e4e5 f7f5 e1e2 e8f7", 0x00fdd303c946bdd9ULL},
+		{"a2a4 b7b5 h2h4 b5b4 c2c4", 0x3c8123ea7b067637ULL},
+		{"a2a4 b7b5 h2h4 b5b4 c2c4 b4c3 a1a3", 0x5c3f9b829b279560ULL},
+	};
+	Board board;
+	for (const auto &entry : cases) {
+		board.setStartingPosition();
+		std::string moves = entry.moves;
+		for (size_t start = 0; start < moves.size(); start += 5) {
+			board.play(findMove(board, moves.substr(start, 4)));
+		}
+		char key[17];
+		std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)Polyglot::keyOf(board));
+		check(Polyglot::keyOf(board) == entry.key, std::string("Polyglot key after \"") + entry.moves + "\": " + key);
+	}
+}
+
+struct TestGroup {
+	const char *name;
+	void (*run)();
+}; // struct TestGroup
+
+int main(int argc, char **argv) {
+	std::string filter = argc > 1 ? argv[1] : "";
+	static const TestGroup groups[] = {
+		{"fen", testFEN},
+		{"see", testSEE},
+		{"packed", testPacked},
+		{"san", testSAN},
+		{"pgn", testPGN},
+		{"polyglot", testPolyglot},
+		{"tt", testTT},
+	};
+	for (const TestGroup &group : groups) {
+		if (std::string(group.name).find(filter) == std::string::npos) continue;
+		int failuresBefore = failures;
+		group.run();
+		std::cout << (failures == failuresBefore ? "ok   " : "FAIL ") << group.name << std::endl;
+	}
+	std::cout << checks << " checks, " << (failures == 0 ? "all passed." : std::to_string(failures) + " failed.") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
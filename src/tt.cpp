@@ -0,0 +1,110 @@
+#include "tt.h"
+
+#include "profile.h"
+
+
+TranspositionTable::TranspositionTable(size_t megabytes) {
+	this->buckets = nullptr;
+	this->bucketCount = 0;
+	this->generation = 0;
+	this->resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() {
+	delete[] this->buckets;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+	if (megabytes < 1) megabytes = 1;
+	delete[] this->buckets;
+	this->sizeMB = megabytes;
+	this->bucketCount = megabytes * 1024 * 1024 / sizeof(TTBucket);
+	this->buckets = new TTBucket[this->bucketCount];
+	this->clear();
+}
+
+void TranspositionTable::clear() {
+	for (size_t i = 0; i < this->bucketCount; i++) {
+		for (int j = 0; j < TTBucket::SIZE; j++) {
+			this->buckets[i].entries[j].check.store(0, std::memory_order_relaxed);
+			this->buckets[i].entries[j].data.store(0, std::memory_order_relaxed);
+		}
+	}
+	this->generation = 0;
+}
+
+void TranspositionTable::newGeneration() {
+	this->generation = (this->generation + 1) & 63;
+}
+
+TTBucket *TranspositionTable::bucketFor(uint64_t key) const {
+	// maps the key onto [0, bucketCount) without a division
+	return &this->buckets[(size_t)(((unsigned __int128)key * this->bucketCount) >> 64)];
+}
+
+bool TranspositionTable::probe(uint64_t key, TTHit &hit) const {
+	PROFILE_SCOPE(TTPROBE);
+	TTBucket *bucket = this->bucketFor(key);
+	for (int i = 0; i < TTBucket::SIZE; i++) {
+		uint64_t data = bucket->entries[i].data.load(std::memory_order_relaxed);
+		uint64_t check = bucket->entries[i].check.load(std::memory_order_relaxed);
+		if ((check ^ data) == key && data != 0) {
+			hit.depth = (int)(data & 0xFF) - 1;
+			hit.bound = (data >> 14) & 3;
+			hit.payload = data >> 16;
+			return true;
+		}
+	}
+	return false;
+}
+
+void TranspositionTable::store(uint64_t key, int depth, uint8_t bound, uint64_t payload) {
+	PROFILE_SCOPE(TTSTORE);
+	TTBucket *bucket = this->bucketFor(key);
+	TTEntry *replace = &bucket->entries[0];
+	int worstScore = 1 << 30;
+	for (int i = 0; i < TTBucket::SIZE; i++) {
+		TTEntry &entry = bucket->entries[i];
+		uint64_t entryData = entry.data.load(std::memory_order_relaxed);
+		uint64_t entryCheck = entry.check.load(std::memory_order_relaxed);
+		if ((entryCheck ^ entryData) == key && entryData != 0) {
+			int entryDepth = (int)(entryData & 0xFF) - 1;
+			bool current = ((entryData >> 8) & 63) == this->generation;
+			if (current && bound != BOUND_EXACT && depth < entryDepth - KEEPMARGIN) return;
+			replace = &entry;
+			break;
+		}
+		if (entryData == 0) {
+			replace = &entry;
+			break;
+		}
+		// prefer overwriting shallow entries, and anything left over from earlier searches
+		int age = (this->generation - (int)((entryData >> 8) & 63)) & 63;
+		int score = (int)(entryData & 0xFF) - 8 * age;
+		if (score < worstScore) {
+			worstScore = score;
+			replace = &entry;
+		}
+	}
+	if (depth < -1) depth = -1;
+	if (depth > 254) depth = 254;
+	uint64_t data = (uint64_t)(depth + 1) | ((uint64_t)this->generation << 8) | ((uint64_t)(bound & 3) << 14) | ((payload & PAYLOAD_MASK) << 16);
+	replace->data.store(data, std::memory_order_relaxed);
+	replace->check.store(key ^ data, std::memory_order_relaxed);
+}
+
+int TranspositionTable::hashfull() const {
+	int used = 0;
+	size_t sample = this->bucketCount < 1000 ? this->bucketCount : 1000;
+	for (size_t i = 0; i < sample; i++) {
+		for (int j = 0; j < TTBucket::SIZE; j++) {
+			uint64_t data = this->buckets[i].entries[j].data.load(std::memory_order_relaxed);
+			if (data != 0 && ((data >> 8) & 63) == this->generation) used++;
+		}
+	}
+	return sample ? used * 1000 / (int)(sample * TTBucket::SIZE) : 0;
+}
+
+size_t TranspositionTable::getSizeMB() const {
+	return this->sizeMB;
+}
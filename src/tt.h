@@ -0,0 +1,65 @@
+#ifndef TT_H
+#define TT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// One slot of the table, shared by all search threads without locks. The key is
+// stored xored with the data, so a write torn between two threads simply fails
+// to match instead of returning garbage. Both words are relaxed atomics.
+// The data word holds the depth (bits 0-7), the table generation (8-13),
+// a bound (14-15) and 48 bits of payload that the user of the table decides on:
+// search packs a move and scores into it, perft a node count.
+struct TTEntry {
+	std::atomic<uint64_t> check;
+	std::atomic<uint64_t> data;
+}; // struct TTEntry
+
+struct alignas(64) TTBucket {
+	static constexpr int SIZE = 4;
+	TTEntry entries[SIZE];
+}; // struct TTBucket
+
+struct TTHit {
+	int depth;
+	uint8_t bound;
+	uint64_t payload;
+}; // struct TTHit
+
+class TranspositionTable {
+	public:
+		TranspositionTable(size_t megabytes = 16);
+		~TranspositionTable();
+		TranspositionTable(const TranspositionTable &) = delete;
+		TranspositionTable &operator=(const TranspositionTable &) = delete;
+
+		void resize(size_t megabytes);
+		void clear();
+		// Starts a new search: entries from older generations get replaced first.
+		void newGeneration();
+		bool probe(uint64_t key, TTHit &hit) const;
+		// An entry for the same key is only kept if it's from this generation,
+		// deeper than KEEPMARGIN plies past the new depth and the new bound isn't exact.
+		void store(uint64_t key, int depth, uint8_t bound, uint64_t payload);
+		// Permille of the sampled entries written during the current generation, as UCI wants it.
+		int hashfull() const;
+		size_t getSizeMB() const;
+
+		static constexpr uint64_t PAYLOAD_MASK = (1ULL << 48) - 1;
+		static constexpr uint8_t BOUND_NONE = 0;
+		static constexpr uint8_t BOUND_UPPER = 1;
+		static constexpr uint8_t BOUND_LOWER = 2;
+		static constexpr uint8_t BOUND_EXACT = 3;
+		// a same-key entry this many plies deeper survives a non-exact store
+		static constexpr int KEEPMARGIN = 2;
+	private:
+		TTBucket *bucketFor(uint64_t key) const;
+
+		TTBucket *buckets;
+		size_t bucketCount;
+		size_t sizeMB;
+		uint8_t generation;
+}; // class TranspositionTable
+
+#endif
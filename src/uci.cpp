@@ -0,0 +1,263 @@
+#include "uci.h"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <iostream>
+#include <sstream>
+
+#include "tablebase.h"
+
+UciEngine::UciEngine() : tt(DEFAULTHASHMB), mcts(DEFAULTMCTSMB), bookRng(time(NULL)) {
+	this->threads = 1;
+	this->useMcts = false;
+	this->moveOverheadMs = DEFAULTMOVEOVERHEADMS;
+	this->stop = false;
+	this->board.setStartingPosition();
+}
+
+UciEngine::~UciEngine() {
+	this->stopSearch();
+}
+
+void UciEngine::send(const std::string &line) {
+	std::lock_guard<std::mutex> lock(this->outputMutex);
+	std::cout << line << std::endl;
+}
+
+void UciEngine::loop(std::istream &in) {
+	std::string line;
+	while (std::getline(in, line)) {
+		std::istringstream args(line);
+		std::string command;
+		args >> command;
+		if (command == "uci") {
+			this->identify();
+		} else if (command == "isready") {
+			this->send("readyok");
+		} else if (command == "setoption") {
+			this->stopSearch();
+			this->setOption(args);
+		} else if (command == "ucinewgame") {
+			this->stopSearch();
+			this->tt.clear();
+			this->mcts.clear();
+		} else if (command == "position") {
+			this->stopSearch();
+			this->position(args);
+		} else if (command == "go") {
+			this->go(args);
+		} else if (command == "stop") {
+			this->stopSearch();
+		} else if (command == "quit") {
+			break;
+		} else if (command == "d") {
+			this->stopSearch();
+			this->board.print();
+			this->send(this->board.exportFEN());
+		} else if (!command.empty()) {
+			this->send("info string unknown command " + command);
+		}
+	}
+	this->stopSearch();
+}
+
+void UciEngine::identify() {
+	this->send("id name chess");
+	this->send("id author chess developers");
+	this->send("option name Hash type spin default " + std::to_string(DEFAULTHASHMB) + " min 1 max " + std::to_string(MAXHASHMB));
+	this->send("option name Threads type spin default 1 min 1 max " + std::to_string(MAXTHREADS));
+	this->send("option name TablebasePath type string default <empty>");
+	this->send("option name BookFile type string default <empty>");
+	this->send("option name UseMCTS type check default false");
+	this->send("option name MCTS Memory type spin default " + std::to_string(DEFAULTMCTSMB) + " min 1 max " + std::to_string(MAXHASHMB));
+	this->send("option name Move Overhead type spin default " + std::to_string(DEFAULTMOVEOVERHEADMS) + " min 0 max 5000");
+	this->send("uciok");
+}
+
+// setoption name <id> [value <x>], the name may contain spaces
+void UciEngine::setOption(std::istream &args) {
+	std::string token, name, value;
+	args >> token;
+	while (args >> token && token != "value") {
+		name += (name.empty() ? "" : " ") + token;
+	}
+	while (args >> token) {
+		value += (value.empty() ? "" : " ") + token;
+	}
+	if (name == "Hash") {
+		this->tt.resize(std::clamp(atoi(value.c_str()), 1, MAXHASHMB));
+	} else if (name == "Threads") {
+		this->threads = std::clamp(atoi(value.c_str()), 1, MAXTHREADS);
+	} else if (name == "TablebasePath") {
+		this->send("info string loaded " + std::to_string(Tablebase::load(value)) + " tablebases");
+	} else if (name == "UseMCTS") {
+		this->useMcts = value == "true";
+	} else if (name == "MCTS Memory") {
+		this->mcts.resize(std::clamp(atoi(value.c_str()), 1, MAXHASHMB));
+	} else if (name == "BookFile") {
+		this->book.close();
+		if (value.empty() || value == "<empty>") return;
+		if (!this->book.open(value)) {
+			this->send("info string can't open book " + value);
+			return;
+		}
+		this->send("info string book has " + std::to_string(this->book.size()) + " entries");
+	} else if (name == "Move Overhead") {
+		this->moveOverheadMs = std::clamp(atoi(value.c_str()), 0, 5000);
+	} else {
+		this->send("info string unknown option " + name);
+	}
+}
+
+// UCI moves are matched against the legal moves, so anything illegal is refused instead of played
+Move UciEngine::parseMove(Board &board, const std::string &text) {
+	MoveList moves;
+	board.getLegalMoves(moves);
+	for (Move move : moves) {
+		if (Board::toUCI(move) == text) return move;
+	}
+	return Move::none();
+}
+
+// position startpos|fen <fen> [moves <move>...]
+// The command is set up on a board of its own and only replaces the current
+// position once all of it checked out, anything wrong leaves the old one.
+void UciEngine::position(std::istream &args) {
+	Board board;
+	std::string token, fen;
+	args >> token;
+	if (token == "startpos") {
+		board.setStartingPosition();
+		args >> token;
+	} else if (token == "fen") {
+		while (args >> token && token != "moves") {
+			fen += (fen.empty() ? "" : " ") + token;
+		}
+		if (!board.loadFromFEN(fen)) {
+			this->send("info string invalid fen " + fen + ", position unchanged");
+			return;
+		}
+	} else {
+		this->send("info string expected startpos or fen, position unchanged");
+		return;
+	}
+	if (token == "moves") {
+		while (args >> token) {
+			Move move = parseMove(board, token);
+			if (move == Move::none()) {
+				this->send("info string illegal move " + token + ", position unchanged");
+				return;
+			}
+			board.play(move);
+		}
+	}
+	this->board.copyPosition(board);
+}
+
+// go [depth <d>] [nodes <n>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>] [movestogo <n>] [infinite]
+void UciEngine::go(std::istream &args) {
+	this->stopSearch();
+	SearchLimits limits;
+	limits.threads = this->threads;
+	limits.stop = &this->stop;
+	int64_t time[2] = {0, 0}, increment[2] = {0, 0}, moveTime = 0;
+	int movesToGo = 0;
+	bool infinite = false;
+	std::string token;
+	while (args >> token) {
+		if (token == "depth") args >> limits.depth;
+		else if (token == "nodes") args >> limits.nodes;
+		else if (token == "movetime") args >> moveTime;
+		else if (token == "wtime") args >> time[Board::WHITE];
+		else if (token == "btime") args >> time[Board::BLACK];
+		else if (token == "winc") args >> increment[Board::WHITE];
+		else if (token == "binc") args >> increment[Board::BLACK];
+		else if (token == "movestogo") args >> movesToGo;
+		else if (token == "infinite") infinite = true;
+	}
+	if (infinite) limits.depth = Searcher::MAXPLY;
+
+	// in book there is nothing to think about
+	Move bookMove = infinite || !this->book.isOpen() ? Move::none() : this->book.pick(this->board, this->bookRng);
+	if (bookMove != Move::none()) {
+		this->send("bestmove " + Board::toUCI(bookMove));
+		return;
+	}
+
+	bool side = this->board.getSideToMove();
+	if (moveTime > 0) {
+		limits.timeMs = std::max<int64_t>(1, moveTime - this->moveOverheadMs);
+	} else if (!infinite && time[side] > 0) {
+		// Aim for an even share of the clock plus most of the increment, but let a
+		// running iteration go on up to a few times that. Neither may get near the flag.
+		int64_t available = std::max<int64_t>(1, time[side] - this->moveOverheadMs);
+		int64_t movesLeft = movesToGo > 0 ? std::min(movesToGo, 50) : DEFAULTMOVESTOGO;
+		int64_t target = available / movesLeft + increment[side] * 3 / 4;
+		limits.timeMs = std::max<int64_t>(1, std::min(target * 4, available - available / 8));
+		limits.softTimeMs = std::max<int64_t>(1, std::min(target, limits.timeMs / 2));
+	}
+
+	if (this->useMcts) {
+		this->goMcts(limits, infinite);
+		return;
+	}
+
+	limits.onIteration = [this](const SearchResult &result) {
+		std::string line = "info depth " + std::to_string(result.depth) + " score " + formatScore(result.score)
+			+ " nodes " + std::to_string(result.nodes) + " nps " + std::to_string(result.nps)
+			+ " time " + std::to_string((int64_t)(result.seconds * 1000)) + " hashfull " + std::to_string(this->tt.hashfull()) + " pv";
+		for (Move move : result.pv) {
+			line += " " + Board::toUCI(move);
+		}
+		this->send(line);
+	};
+
+	this->stop = false;
+	this->searchThread = std::thread([this, limits, infinite]() {
+		SearchResult result = this->board.search(limits, this->tt);
+		// an infinite search may only answer once the GUI says stop, even if it ran out of depth
+		while (infinite && !this->stop.load()) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		this->send("bestmove " + (result.bestMove == Move::none() ? std::string("0000") : Board::toUCI(result.bestMove)));
+	});
+}
+
+// the alpha-beta limits carry over, nodes counting playouts. The tree has no depth
+// to stop at, so without a node or time limit the depth buys a number of playouts.
+void UciEngine::goMcts(const SearchLimits &searchLimits, bool infinite) {
+	MctsLimits limits;
+	limits.playouts = searchLimits.nodes;
+	limits.timeMs = searchLimits.timeMs;
+	if (!infinite && limits.playouts == 0 && limits.timeMs == 0) {
+		limits.playouts = (uint64_t)std::max(1, searchLimits.depth) * MCTSPLAYOUTSPERDEPTH;
+	}
+	limits.threads = searchLimits.threads;
+	limits.stop = &this->stop;
+	limits.onProgress = [this](const MctsResult &result) {
+		std::string line = "info depth " + std::to_string(result.pv.size()) + " score cp " + std::to_string(result.score)
+			+ " nodes " + std::to_string(result.playouts) + " nps " + std::to_string(result.playoutsPerSecond)
+			+ " time " + std::to_string((int64_t)(result.seconds * 1000)) + " pv";
+		for (Move move : result.pv) {
+			line += " " + Board::toUCI(move);
+		}
+		this->send(line);
+		this->send("info string tree " + std::to_string(result.treeNodes) + " nodes, " + std::to_string(result.treeBytes >> 20)
+			+ " MB" + (result.treeFull ? ", full" : ""));
+	};
+	this->stop = false;
+	this->searchThread = std::thread([this, limits, infinite]() {
+		MctsResult result = this->mcts.search(this->board, limits);
+		limits.onProgress(result);
+		while (infinite && !this->stop.load()) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+		this->send("bestmove " + (result.bestMove == Move::none() ? std::string("0000") : Board::toUCI(result.bestMove)));
+	});
+}
+
+void UciEngine::stopSearch() {
+	this->stop = true;
+	if (this->searchThread.joinable()) this->searchThread.join();
+}
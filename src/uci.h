@@ -0,0 +1,61 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include <atomic>
+#include <istream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "board.h"
+#include "book.h"
+#include "mcts.h"
+#include "search.h"
+#include "tt.h"
+
+// Universal Chess Interface front end. Commands are read on the calling thread
+// and every search runs on a thread of its own, so stop and isready get an
+// answer while the engine is thinking.
+class UciEngine {
+	public:
+		UciEngine();
+		~UciEngine();
+		// reads commands until quit or the end of the input
+		void loop(std::istream &in);
+
+		static constexpr int DEFAULTHASHMB = 16;
+		static constexpr int MAXHASHMB = 65536;
+		static constexpr int MAXTHREADS = 256;
+		static constexpr int DEFAULTMCTSMB = 256;
+		// time kept back on every move for the GUI and the pipe
+		static constexpr int DEFAULTMOVEOVERHEADMS = 30;
+		// moves left in the game when the GUI doesn't say
+		static constexpr int DEFAULTMOVESTOGO = 30;
+		// playouts per ply of a go depth when MCTS has no node or time limit
+		static constexpr uint64_t MCTSPLAYOUTSPERDEPTH = 1000;
+	private:
+		void send(const std::string &line);
+		void identify();
+		void setOption(std::istream &args);
+		void position(std::istream &args);
+		void go(std::istream &args);
+		void goMcts(const SearchLimits &limits, bool infinite);
+		void stopSearch();
+		static Move parseMove(Board &board, const std::string &text);
+
+		Board board;
+		TranspositionTable tt;
+		int threads;
+		int moveOverheadMs;
+		// the MCTS player instead of alpha-beta, its tree lives on from move to move
+		bool useMcts;
+		MctsTree mcts;
+		OpeningBook book;
+		Rng bookRng;
+		std::thread searchThread;
+		std::atomic<bool> stop;
+		// info lines come from the search thread, everything else from the input thread
+		std::mutex outputMutex;
+}; // class UciEngine
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+namespace Zobrist {
+	struct Keys {
+		uint64_t pieces[13][64]; // indexed by Board piece code, row 0 (EMPTY) stays zero
+		uint64_t castling[16];   // indexed by the KQkq rights as bits 0-3
+		uint64_t enPassant[8];   // indexed by file
+		uint64_t side;           // xored in when black is to move
+	}; // struct Keys
+
+	// splitmix64, so the keys are fixed at compile time and identical on every platform
+	constexpr uint64_t nextKey(uint64_t &state) {
+		state += 0x9E3779B97F4A7C15ULL;
+		uint64_t z = state;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+
+	constexpr Keys generateKeys() {
+		Keys keys = {};
+		uint64_t state = 0x1234ABCD;
+		for (int piece = 1; piece < 13; piece++) {
+			for (int square = 0; square < 64; square++) {
+				keys.pieces[piece][square] = nextKey(state);
+			}
+		}
+		// each right gets its own key and combinations are the xor of their parts
+		uint64_t rights[4] = {nextKey(state), nextKey(state), nextKey(state), nextKey(state)};
+		for (int mask = 0; mask < 16; mask++) {
+			for (int i = 0; i < 4; i++) {
+				if (mask & (1 << i)) keys.castling[mask] ^= rights[i];
+			}
+		}
+		for (int file = 0; file < 8; file++) {
+			keys.enPassant[file] = nextKey(state);
+		}
+		keys.side = nextKey(state);
+		return keys;
+	}
+
+	inline constexpr Keys keys = generateKeys();
+} // namespace Zobrist
+
+#endif